@@ -0,0 +1,38 @@
+#include "BucketQueue.h"
+
+void BucketQueue::push(NodeId id, int key, int tie) {
+    if (key >= (int)buckets.size()) buckets.resize(key + 1);
+    Bucket& b = buckets[key];
+    if (tie >= (int)b.byTie.size()) b.byTie.resize(tie + 1);
+    b.byTie[tie].ids.push_back(id);
+    if (b.nb == 0 || tie < b.lo) b.lo = tie;
+    b.nb++;
+    if (nb == 0 || key < lo) lo = key;
+    nb++;
+}
+
+int BucketQueue::minKey() {
+    while (buckets[lo].nb == 0) ++lo;
+    return lo;
+}
+
+NodeId BucketQueue::pop() {
+    Bucket& b = buckets[minKey()];
+    List* l = &b.byTie[b.lo];
+    while (l->ids.size() == l->head) l = &b.byTie[++b.lo];
+
+    NodeId id;
+    if (lifo) {
+        id = l->ids.back();
+        l->ids.pop_back();
+    } else {
+        id = l->ids[l->head++];
+        if (l->head == l->ids.size()) {
+            l->ids.clear();
+            l->head = 0;
+        }
+    }
+    b.nb--;
+    nb--;
+    return id;
+}
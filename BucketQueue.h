@@ -0,0 +1,44 @@
+#ifndef BUCKETQUEUE_H
+#define BUCKETQUEUE_H
+
+#include "Node.h"
+#include <vector>
+
+// File de priorite pour A* et Greedy. f et h sont des petits entiers, donc
+// au lieu d'un tas on a un seau par cle (f pour A*, h pour Greedy) et dans
+// chaque seau un sous-seau par departage (h pour A*). On ne range que des
+// NodeId, push et pop sont en O(1) amorti.
+// A egalite complete : le dernier arrive sort en premier (lifo, plus profond
+// d'abord, c'est ce qui developpe le moins sur Sokoban) ou le premier (fifo)
+class BucketQueue {
+public:
+    explicit BucketQueue(bool lifo = true) : lifo(lifo) {}
+
+    // key et tie >= 0
+    void push(NodeId id, int key, int tie = 0);
+    // plus petite cle, puis plus petit departage. La file ne doit pas etre vide
+    NodeId pop();
+    // cle du prochain pop, sans le sortir. La file ne doit pas etre vide
+    int minKey();
+
+    bool empty() const { return nb == 0; }
+    std::size_t size() const { return nb; }
+
+private:
+    struct List {
+        std::vector<NodeId> ids;
+        std::size_t head = 0; // fifo : les ids avant head sont deja sortis
+    };
+    struct Bucket {
+        std::vector<List> byTie;
+        int lo = 0; // aucun sous-seau non vide avant lo
+        std::size_t nb = 0;
+    };
+
+    bool lifo;
+    std::vector<Bucket> buckets;
+    int lo = 0; // aucun seau non vide avant lo
+    std::size_t nb = 0;
+};
+
+#endif // BUCKETQUEUE_H
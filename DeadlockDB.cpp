@@ -0,0 +1,332 @@
+#include "DeadlockDB.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+const int DeadlockDB::MAX_BOXES;
+
+namespace {
+
+const uint32_t DB_VERSION = 1;
+const std::size_t MAX_STATES = 4000000;  // au dela on abandonne cette taille de motif
+const double MAX_COMBOS = 3000000.0;     // combinaisons de cases a tester
+const double MAX_WORK = 200000000.0;     // cases visitees par les remplissages, pour une taille
+
+// tuple de caisses triees -> cle (16 bits par case)
+uint64_t pack(const Cell* b, int k) {
+    uint64_t key = 0;
+    for (int i = 0; i < k; ++i) key |= (uint64_t)b[i] << (16 * i);
+    return key;
+}
+
+double binom(int n, int k) {
+    double r = 1;
+    for (int i = 0; i < k; ++i) r = r * (n - i) / (i + 1);
+    return r;
+}
+
+} // namespace
+
+void DeadlockDB::init(const std::string& cache, const std::vector<uint8_t>& cells, const std::vector<Cell>& nbr,
+                      Cell start, int maxBoxes, const std::function<bool()>& stop) {
+    maxBoxes = std::max(2, std::min(maxBoxes, MAX_BOXES));
+
+    // cle du niveau : murs, goals, cases mortes et voisins (= la forme du plateau)
+    uint64_t key = 1469598103934665603ULL;
+    auto mix = [&](uint64_t v) { key = (key ^ v) * 1099511628211ULL; };
+    mix(DB_VERSION);
+    mix(maxBoxes);
+    mix(start);
+    for (std::size_t c = 0; c < cells.size(); ++c) mix(cells[c] & (C_WALL | C_GOAL | C_DEAD));
+    for (Cell x : nbr) mix(x);
+
+    loaded = file.open(cache) && attach(file.data(), file.size(), key, cells.size());
+    if (loaded) return;
+    file.close();
+
+    if (!build(cells, nbr, start, maxBoxes, key, stop)) {
+        mem.clear();
+        mem.shrink_to_fit();
+        return;
+    }
+
+    // plusieurs process peuvent construire le meme niveau en meme temps :
+    // chacun son fichier temporaire, le dernier qui remplace gagne (ils ont
+    // tous ecrit la meme chose)
+    std::string tmp = MappedFile::tempName(cache);
+    bool written;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (out) out.write((const char*)mem.data(), mem.size());
+        written = (bool)out;
+    }
+    if (written && MappedFile::replace(tmp, cache) && file.open(cache)
+        && attach(file.data(), file.size(), key, cells.size())) {
+        mem.clear();
+        mem.shrink_to_fit();
+        return;
+    }
+    std::remove(tmp.c_str());
+    file.close();
+    attach(mem.data(), mem.size(), key, cells.size());
+}
+
+bool DeadlockDB::attach(const uint8_t* data, std::size_t size, uint64_t key, uint32_t nbCells) {
+    base = nullptr;
+    if (size < sizeof(Header)) return false;
+    const Header* h = (const Header*)data;
+    if (std::string(h->magic, 4) != "SKDL" || h->version != DB_VERSION) return false;
+    if (h->key != key || h->nbCells != nbCells) return false;
+
+    std::size_t pos = sizeof(Header);
+    for (int k = 2; k <= MAX_BOXES; ++k) {
+        std::size_t offBytes = (nbCells + 1) * sizeof(uint32_t);
+        std::size_t entBytes = (std::size_t)h->count[k] * (k - 1) * sizeof(Cell);
+        entBytes = (entBytes + 3) & ~(std::size_t)3;
+        if (pos + offBytes + entBytes > size) return false;
+        off[k] = (const uint32_t*)(data + pos);
+        ent[k] = (const Cell*)(data + pos + offBytes);
+        pos += offBytes + entBytes;
+    }
+    head = h;
+    base = data;
+    return true;
+}
+
+int DeadlockDB::nbPatterns() const {
+    if (!base) return 0;
+    int nb = 0;
+    for (int k = 2; k <= MAX_BOXES; ++k) nb += head->count[k] / k;
+    return nb;
+}
+
+bool DeadlockDB::dead(const Cell* bx, int n, Cell moved) const {
+    if (!base) return false;
+    for (int k = 2; k <= MAX_BOXES && k <= n; ++k) {
+        const Cell* e = ent[k] + off[k][moved] * (k - 1);
+        const Cell* e_end = ent[k] + off[k][moved + 1] * (k - 1);
+        for (; e != e_end; e += k - 1) {
+            bool all = true;
+            for (int i = 0; i < k - 1 && all; ++i) all = std::binary_search(bx, bx + n, e[i]);
+            if (all) return true;
+        }
+    }
+    return false;
+}
+
+bool DeadlockDB::build(const std::vector<uint8_t>& cells, const std::vector<Cell>& nbr, Cell start,
+                       int maxBoxes, uint64_t key, const std::function<bool()>& stop) {
+    const int nbCells = cells.size();
+    auto step = [&](Cell c, int d) { return c == NO_CELL ? NO_CELL : nbr[c * 4 + d]; };
+
+    // interieur du niveau = ce que le joueur atteint sans caisses
+    std::vector<char> inner(nbCells, 0);
+    std::vector<Cell> todo = {start};
+    inner[start] = 1;
+    while (!todo.empty()) {
+        Cell cur = todo.back();
+        todo.pop_back();
+        for (int d = 0; d < 4; ++d) {
+            Cell x = step(cur, d);
+            if (x == NO_CELL || (cells[x] & C_WALL) || inner[x]) continue;
+            inner[x] = 1;
+            todo.push_back(x);
+        }
+    }
+    std::vector<Cell> live, goals;
+    int nbInner = 0;
+    for (int c = 0; c < nbCells; ++c) {
+        if (!inner[c]) continue;
+        nbInner++;
+        if (!(cells[c] & C_DEAD)) live.push_back(c);
+        if (cells[c] & C_GOAL) goals.push_back(c);
+    }
+
+    // remplissage avec tampon pour eviter de tout remettre a zero a chaque fois.
+    // Renvoie la plus petite case de la zone (= position normalisee du joueur)
+    std::vector<uint32_t> mark(nbCells, 0), zone(nbCells, 0);
+    uint32_t stamp = 0;
+    std::vector<Cell> stack;
+    double work = 0; // cases visitees pour la taille en cours
+    auto flood = [&](const Cell* b, int k, Cell p, std::vector<uint32_t>& mark) {
+        ++stamp;
+        Cell mini = p;
+        mark[p] = stamp;
+        stack.assign(1, p);
+        while (!stack.empty()) {
+            Cell cur = stack.back();
+            stack.pop_back();
+            work++;
+            for (int d = 0; d < 4; ++d) {
+                Cell x = step(cur, d);
+                if (x == NO_CELL || !inner[x] || mark[x] == stamp) continue;
+                if (std::find(b, b + k, x) != b + k) continue;
+                mark[x] = stamp;
+                if (x < mini) mini = x;
+                stack.push_back(x);
+            }
+        }
+        return mini;
+    };
+
+    // motifs trouves : pats[k][c] = les autres cases des motifs de taille k qui contiennent c
+    std::vector<std::vector<std::vector<Cell>>> pats(MAX_BOXES + 1, std::vector<std::vector<Cell>>(nbCells));
+    std::vector<std::unordered_set<uint64_t>> deadKeys(MAX_BOXES + 1);
+    // appele souvent, on ne demande a stop qu'une fois sur 1024
+    unsigned polls = 0;
+    auto stopped = [&]() { return stop && (++polls & 1023) == 0 && stop(); };
+
+    for (int k = 2; k <= maxBoxes; ++k) {
+        if ((int)goals.size() < k || (int)live.size() < k) break;
+        if (binom(live.size(), k) > MAX_COMBOS) break;
+        // au pire un remplissage du niveau par etat atteint
+        if (binom(live.size(), k) * nbInner > MAX_WORK * 4) break;
+        work = 0;
+
+        // 1. recherche a l'envers : etats = (caisses triees, case mini de la zone du joueur)
+        std::unordered_map<uint64_t, std::vector<Cell>> seen; // tuple -> zones joueur deja vues
+        std::queue<std::pair<uint64_t, Cell>> q;
+        auto add = [&](uint64_t t, Cell p) {
+            std::vector<Cell>& v = seen[t];
+            if (std::find(v.begin(), v.end(), p) != v.end()) return;
+            v.push_back(p);
+            q.push({t, p});
+        };
+
+        // depart : toutes les facons de mettre k caisses sur des goals, joueur dans chaque zone
+        std::vector<int> idx(k);
+        for (int i = 0; i < k; ++i) idx[i] = i;
+        Cell b[MAX_BOXES];
+        while (true) {
+            for (int i = 0; i < k; ++i) b[i] = goals[idx[i]];
+            // zones libres : on remplit depuis chaque case pas encore vue
+            uint32_t first = stamp + 1;
+            for (int c = 0; c < nbCells; ++c) {
+                if (!inner[c] || mark[c] >= first || std::find(b, b + k, c) != b + k) continue;
+                add(pack(b, k), flood(b, k, c, mark));
+            }
+            if (stopped()) return false;
+
+            int i = k - 1;
+            while (i >= 0 && idx[i] == (int)goals.size() - k + i) --i;
+            if (i < 0) break;
+            idx[i]++;
+            for (int j = i + 1; j < k; ++j) idx[j] = idx[j - 1] + 1;
+        }
+
+        bool complete = true;
+        Cell nb[MAX_BOXES];
+        // voisins directs dans l'ordre du tour : haut, droite, bas, gauche
+        // (directions 0 haut, 1 bas, 2 gauche, 3 droite comme nbr)
+        const int around[4] = {0, 3, 1, 2};
+        while (!q.empty()) {
+            if (seen.size() > MAX_STATES || work > MAX_WORK) { complete = false; break; }
+            if (stopped()) return false;
+            uint64_t t = q.front().first;
+            Cell p = q.front().second;
+            q.pop();
+            for (int i = 0; i < k; ++i) b[i] = (t >> (16 * i)) & 0xFFFF;
+
+            flood(b, k, p, zone); // zone du joueur dans cet etat
+            uint32_t cur = stamp;
+
+            // tirer la caisse i dans la direction d : le joueur est en b+d et recule en b+2d
+            for (int i = 0; i < k; ++i) {
+                for (int d = 0; d < 4; ++d) {
+                    Cell pc = step(b[i], d);
+                    if (pc == NO_CELL || zone[pc] != cur) continue;
+                    Cell qc = step(pc, d);
+                    if (qc == NO_CELL || !inner[qc] || std::find(b, b + k, qc) != b + k) continue;
+
+                    std::copy(b, b + k, nb);
+                    nb[i] = pc;
+                    std::sort(nb, nb + k);
+
+                    // Sans refaire de remplissage : la nouvelle zone est
+                    // l'ancienne moins pc plus b[i], si b[i] ne touche pas
+                    // d'autre zone et si pc ne coupe pas la zone en deux
+                    // (ses voisins dans la zone se rejoignent par le tour
+                    // de pc). Sinon, ou si pc etait la case mini, on remplit
+                    auto in = [&](Cell c) { return c == b[i] || (c != NO_CELL && zone[c] == cur && c != pc); };
+                    bool fast = pc != p;
+                    for (int e = 0; e < 4 && fast; ++e) {
+                        Cell x = step(b[i], e);
+                        if (x == NO_CELL || x == pc || !inner[x] || zone[x] == cur) continue;
+                        if (std::find(b, b + k, x) == b + k) fast = false;
+                    }
+                    if (fast) {
+                        // groupes = voisins directs dans la zone - liens par un coin
+                        int nbIn = 0, links = 0;
+                        for (int s = 0; s < 4; ++s) {
+                            Cell o1 = step(pc, around[s]), o2 = step(pc, around[(s + 1) % 4]);
+                            if (!in(o1)) continue;
+                            nbIn++;
+                            if (in(o2) && in(step(o1, around[(s + 1) % 4]))) links++;
+                        }
+                        if (nbIn - links > 1 && !(nbIn == 4 && links == 4)) fast = false;
+                    }
+                    add(pack(nb, k), fast ? std::min(p, b[i]) : flood(nb, k, qc, mark));
+                }
+            }
+        }
+        if (!complete) break; // on ne peut rien conclure sur cette taille
+
+        // 2. toute combinaison de cases vivantes jamais atteinte est morte.
+        // On ne garde que les motifs minimaux (pas de sous-motif deja mort)
+        for (int i = 0; i < k; ++i) idx[i] = i;
+        while (true) {
+            if (stopped()) return false;
+            for (int i = 0; i < k; ++i) b[i] = live[idx[i]];
+            uint64_t t = pack(b, k);
+            if (!seen.count(t)) {
+                bool minimal = true;
+                for (int mask = 1; mask < (1 << k) - 1 && minimal; ++mask) {
+                    Cell sub[MAX_BOXES];
+                    int sz = 0;
+                    for (int j = 0; j < k; ++j) if (mask & (1 << j)) sub[sz++] = b[j];
+                    if (sz >= 2 && deadKeys[sz].count(pack(sub, sz))) minimal = false;
+                }
+                if (minimal) {
+                    deadKeys[k].insert(t);
+                    for (int j = 0; j < k; ++j) {
+                        for (int o = 0; o < k; ++o) if (o != j) pats[k][b[j]].push_back(b[o]);
+                    }
+                }
+            }
+
+            int i = k - 1;
+            while (i >= 0 && idx[i] == (int)live.size() - k + i) --i;
+            if (i < 0) break;
+            idx[i]++;
+            for (int j = i + 1; j < k; ++j) idx[j] = idx[j - 1] + 1;
+        }
+    }
+
+    // 3. mise a plat dans mem (meme format que le fichier)
+    Header h = {};
+    std::copy("SKDL", "SKDL" + 4, h.magic);
+    h.version = DB_VERSION;
+    h.key = key;
+    h.nbCells = nbCells;
+    for (int k = 2; k <= MAX_BOXES; ++k) {
+        for (int c = 0; c < nbCells; ++c) h.count[k] += pats[k][c].size() / (k - 1);
+    }
+
+    mem.assign((const uint8_t*)&h, (const uint8_t*)&h + sizeof(Header));
+    for (int k = 2; k <= MAX_BOXES; ++k) {
+        std::vector<uint32_t> o(nbCells + 1, 0);
+        std::vector<Cell> e;
+        for (int c = 0; c < nbCells; ++c) {
+            o[c] = e.size() / (k - 1);
+            e.insert(e.end(), pats[k][c].begin(), pats[k][c].end());
+        }
+        o[nbCells] = e.size() / (k - 1);
+        while ((e.size() * sizeof(Cell)) % 4) e.push_back(NO_CELL);
+        mem.insert(mem.end(), (const uint8_t*)o.data(), (const uint8_t*)(o.data() + o.size()));
+        mem.insert(mem.end(), (const uint8_t*)e.data(), (const uint8_t*)(e.data() + e.size()));
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef DEADLOCKDB_H
+#define DEADLOCKDB_H
+
+#include "Node.h"
+#include "MappedFile.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Base de motifs morts : petits groupes de 2 a 4 caisses qu'on ne peut
+// jamais tous mettre sur des goals, quelle que soit la place du joueur.
+// Calcule au premier chargement par une recherche a l'envers (on tire les
+// caisses depuis toutes les facons de les poser sur des goals, tout ce
+// qu'on n'atteint pas est mort), puis mis en cache a cote du niveau
+// (levels/X.txt.dl) et relu avec un mmap les fois suivantes.
+// Le calcul est borne (cases visitees), une taille de motif trop chere est
+// abandonnee et on garde les plus petites.
+class DeadlockDB {
+public:
+    static const int MAX_BOXES = 4;
+
+    // cache : chemin du fichier, start : case du joueur (pour savoir ce qui est dedans).
+    // stop est appele pendant le calcul : s'il dit vrai on s'arrete sans
+    // motifs (ready() reste faux, rien n'est ecrit) et init pourra etre rappele
+    void init(const std::string& cache, const std::vector<uint8_t>& cells, const std::vector<Cell>& nbr,
+              Cell start, int maxBoxes = 3, const std::function<bool()>& stop = nullptr);
+
+    // Vrai si la caisse qui vient d'arriver en moved complete un motif mort.
+    // On ne regarde que les motifs qui contiennent moved (liste par case)
+    bool dead(const Cell* bx, int n, Cell moved) const;
+
+    bool ready() const { return base != nullptr; }
+    int nbPatterns() const;
+    bool fromCache() const { return loaded; }
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t nbCells;
+        uint32_t count[MAX_BOXES + 1]; // nb d'entrees par taille de motif
+    };
+    // Apres le header, pour k = 2..MAX_BOXES :
+    //   uint32_t off[nbCells + 1] puis Cell ent[(k - 1) * count[k]]
+    // les partenaires de la case c sont ent[off[c] .. off[c + 1]) par paquets de k - 1
+
+    const uint8_t* base = nullptr;
+    bool loaded = false; // relu depuis le cache (pas recalcule)
+    const Header* head = nullptr;
+    const uint32_t* off[MAX_BOXES + 1] = {};
+    const Cell* ent[MAX_BOXES + 1] = {};
+    MappedFile file;
+    std::vector<uint8_t> mem; // si on n'a pas pu ecrire le cache
+
+    bool attach(const uint8_t* data, std::size_t size, uint64_t key, uint32_t nbCells);
+    // faux si stop a coupe le calcul
+    bool build(const std::vector<uint8_t>& cells, const std::vector<Cell>& nbr, Cell start,
+               int maxBoxes, uint64_t key, const std::function<bool()>& stop);
+};
+
+#endif // DEADLOCKDB_H
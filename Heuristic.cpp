@@ -0,0 +1,143 @@
+#include "Heuristic.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+const int Heuristic::INF;
+
+void Heuristic::init(const std::vector<uint8_t>& cells, const std::vector<Cell>& nbr,
+                     const std::vector<Cell>& goals, int w, bool pull) {
+    g = goals;
+    int nbCells = cells.size();
+
+    // Manhattan de chaque case vers le goal le plus proche
+    h_man.assign(nbCells, INF);
+    for(int c=0; c<nbCells; ++c) {
+        for(Cell gl : g) {
+            int d = std::abs(c / w - gl / w) + std::abs(c % w - gl % w);
+            if(d < h_man[c]) h_man[c] = d;
+        }
+    }
+
+    // BFS a l'envers depuis chaque goal : la caisse en b a pu venir de
+    // prev = b - d si prev et la case du joueur (prev - d) sont du sol.
+    // En mode pull c'est l'inverse, la caisse a ete tiree depuis prev = b + d
+    // et le joueur etait en b - d.
+    // On ignore les autres caisses donc ca reste un minorant
+    auto step = [&](Cell c, int d) { return c == NO_CELL ? NO_CELL : nbr[c * 4 + d]; };
+    auto floor = [&](Cell c) { return c != NO_CELL && !(cells[c] & C_WALL); };
+
+    dist.assign(g.size(), std::vector<int>(nbCells, INF));
+    for(unsigned int k=0; k<g.size(); ++k) {
+        std::vector<int>& dk = dist[k];
+        std::queue<Cell> q;
+        dk[g[k]] = 0;
+        q.push(g[k]);
+        while(!q.empty()) {
+            Cell b = q.front();
+            q.pop();
+            for(int d=0; d<4; ++d) {
+                Cell prev = step(b, d ^ 1);
+                Cell player = pull ? step(b, d) : step(prev, d ^ 1);
+                if(!floor(prev) || !floor(player)) continue;
+                if(dk[prev] != INF) continue;
+                dk[prev] = dk[b] + 1;
+                q.push(prev);
+            }
+        }
+    }
+}
+
+int Heuristic::eval(Type t, const Cell* bx, int n, uint16_t* assign) const {
+    if(t == GREEDY_MATCH) return greedyMatch(bx, n, assign);
+    if(t == HUNGARIAN) return hungarian(bx, n, assign);
+
+    int val = 0;
+    for(int i=0; i<n; ++i) {
+        val += h_man[bx[i]];
+    }
+    return val;
+}
+
+// On prend les couples (caisse, goal) du plus court au plus long
+int Heuristic::greedyMatch(const Cell* bx, int n, uint16_t* assign) const {
+    int m = g.size();
+    std::vector<std::pair<int, int>> arcs; // (distance, caisse * m + goal)
+    arcs.reserve(n * m);
+    for(int i=0; i<n; ++i) {
+        bool ok = false;
+        for(int k=0; k<m; ++k) {
+            int d = dist[k][bx[i]];
+            if(d == INF) continue;
+            arcs.push_back({d, i * m + k});
+            ok = true;
+        }
+        if(!ok) return INF; // caisse coincee
+    }
+    std::sort(arcs.begin(), arcs.end());
+
+    std::vector<char> boxUsed(n, 0), goalUsed(m, 0);
+    std::vector<int> best(n, INF), bestGoal(n, 0);
+    int val = 0, nb = 0;
+    for(const auto& a : arcs) {
+        int i = a.second / m, k = a.second % m;
+        if(a.first < best[i]) { best[i] = a.first; bestGoal[i] = k; }
+        if(boxUsed[i] || goalUsed[k]) continue;
+        boxUsed[i] = goalUsed[k] = 1;
+        if(assign) assign[i] = k;
+        val += a.first;
+        if(++nb == n) return val;
+    }
+    // le glouton s'est bloque : les caisses restantes prennent leur goal le plus proche
+    for(int i=0; i<n; ++i) {
+        if(boxUsed[i]) continue;
+        val += best[i];
+        if(assign) assign[i] = bestGoal[i];
+    }
+    return val;
+}
+
+// Methode hongroise (version potentiels, n caisses <= m goals), O(n^2 m)
+int Heuristic::hungarian(const Cell* bx, int n, uint16_t* assign) const {
+    int m = g.size();
+    if(n > m) return INF;
+
+    // les arcs impossibles coutent INF, si l'optimum les utilise c'est mort
+    std::vector<int> u(n + 1, 0), v(m + 1, 0), p(m + 1, 0), way(m + 1, 0);
+    for(int i=1; i<=n; ++i) {
+        p[0] = i;
+        int j0 = 0;
+        std::vector<int> minv(m + 1, 2 * INF);
+        std::vector<char> used(m + 1, 0);
+        do {
+            used[j0] = 1;
+            int i0 = p[j0], delta = 2 * INF, j1 = 0;
+            for(int j=1; j<=m; ++j) {
+                if(used[j]) continue;
+                int cur = dist[j - 1][bx[i0 - 1]] - u[i0] - v[j];
+                if(cur < minv[j]) { minv[j] = cur; way[j] = j0; }
+                if(minv[j] < delta) { delta = minv[j]; j1 = j; }
+            }
+            for(int j=0; j<=m; ++j) {
+                if(used[j]) { u[p[j]] += delta; v[j] -= delta; }
+                else minv[j] -= delta;
+            }
+            j0 = j1;
+        } while(p[j0] != 0);
+        do {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while(j0);
+    }
+
+    int val = 0;
+    for(int j=1; j<=m; ++j) {
+        if(p[j] == 0) continue;
+        int d = dist[j - 1][bx[p[j] - 1]];
+        if(d == INF) return INF;
+        if(assign) assign[p[j] - 1] = j - 1;
+        val += d;
+    }
+    return val;
+}
@@ -0,0 +1,44 @@
+#ifndef HEURISTIC_H
+#define HEURISTIC_H
+
+#include "Node.h"
+#include <vector>
+
+// Heuristiques pour A* / Greedy.
+// Les distances sont precalculees une fois par niveau : Manhattan vers le
+// goal le plus proche, et vraies distances en poussees (murs compris) de
+// chaque case vers chaque goal, calculees en tirant la caisse depuis le goal
+// (ou en la poussant si on cherche a l'envers : les "goals" sont alors les
+// cases de depart des caisses et les distances comptent des tirages)
+class Heuristic {
+public:
+    enum Type {
+        MANHATTAN,     // somme des Manhattan au goal le plus proche
+        GREEDY_MATCH,  // affectation gloutonne caisse -> goal (rapide, pas admissible)
+        HUNGARIAN,     // affectation de cout min (admissible)
+    };
+
+    // valeur "infinie" : une caisse ne peut plus atteindre de goal
+    static const int INF = 999999;
+
+    void init(const std::vector<uint8_t>& cells, const std::vector<Cell>& nbr,
+              const std::vector<Cell>& goals, int w, bool pull = false);
+
+    // h complet. Pour les affectations, assign (si non nul) recoit le goal
+    // choisi pour chaque caisse, ce qui permet ensuite de faire des deltas
+    int eval(Type t, const Cell* bx, int n, uint16_t* assign = nullptr) const;
+    static bool needsAssign(Type t) { return t != MANHATTAN; }
+
+    int manhattan(Cell c) const { return h_man[c]; }
+    int pushDist(int goal, Cell c) const { return dist[goal][c]; }
+
+private:
+    std::vector<Cell> g;
+    std::vector<int> h_man;              // Manhattan vers le goal le plus proche
+    std::vector<std::vector<int>> dist;  // dist[goal][case] en poussees (ou tirages)
+
+    int greedyMatch(const Cell* bx, int n, uint16_t* assign) const;
+    int hungarian(const Cell* bx, int n, uint16_t* assign) const;
+};
+
+#endif // HEURISTIC_H
@@ -0,0 +1,199 @@
+#include "LayerFiles.h"
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <queue>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::size_t READ_BUF = 32 * 1024; // octets par fichier lu
+const std::size_t FAN = 32;             // runs fusionnes en meme temps
+const std::size_t FOLD = 8;             // couches a part avant de les mettre dans vus
+
+}
+
+LayerFiles::LayerFiles(const std::string& dir, int width, std::size_t budget) : w(width) {
+    // un nom au hasard, plusieurs solveurs peuvent tourner dans le meme dossier
+    std::random_device rd;
+    char name[32];
+    std::snprintf(name, sizeof(name), "sokoban_bfs_%08x", (unsigned)rd());
+    std::error_code ec;
+    fs::path base = dir.empty() ? fs::temp_directory_path(ec) : fs::path(dir);
+    root = (base / name).string();
+    good = !ec && fs::create_directories(root, ec) && !ec;
+
+    // pendant la fusion il y a FAN runs + FOLD couches + vus + la sortie ouverts
+    std::size_t reserve = (FAN + FOLD + 2) * READ_BUF;
+    std::size_t per = w * sizeof(Cell) + sizeof(uint32_t); // etat + son indice pour le tri
+    cap = std::max<std::size_t>(1024, (budget > 2 * reserve ? budget - reserve : reserve) / per);
+    buf.reserve(cap * w);
+}
+
+LayerFiles::~LayerFiles() {
+    std::error_code ec;
+    if (!root.empty()) fs::remove_all(root, ec);
+}
+
+std::string LayerFiles::layer(int d) const {
+    return root + "/couche" + std::to_string(d);
+}
+
+std::string LayerFiles::newRun() {
+    return root + "/run" + std::to_string(nbRuns++);
+}
+
+bool LayerFiles::less(const Cell* a, const Cell* b) const {
+    // l'ordre des octets suffit, il faut juste que ce soit toujours le meme
+    return std::memcmp(a, b, w * sizeof(Cell)) < 0;
+}
+
+bool LayerFiles::same(const Cell* a, const Cell* b) const {
+    return std::memcmp(a, b, w * sizeof(Cell)) == 0;
+}
+
+void LayerFiles::add(const Cell* s) {
+    buf.insert(buf.end(), s, s + w);
+    if (buf.size() >= cap * w) flush();
+}
+
+// tampon -> run trie, les doublons du tampon sautent deja ici
+void LayerFiles::flush() {
+    std::size_t n = buf.size() / w;
+    if (n == 0) return;
+    std::vector<uint32_t> idx(n);
+    for (std::size_t i = 0; i < n; ++i) idx[i] = i;
+    const Cell* b = buf.data();
+    std::sort(idx.begin(), idx.end(), [&](uint32_t x, uint32_t y) { return less(b + (std::size_t)x * w, b + (std::size_t)y * w); });
+
+    std::string path = newRun();
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) good = false;
+    const Cell* last = nullptr;
+    for (uint32_t i : idx) {
+        const Cell* s = b + (std::size_t)i * w;
+        if (last && same(last, s)) {
+            nbDropped++;
+            continue;
+        }
+        if (f && std::fwrite(s, sizeof(Cell), w, f) != (std::size_t)w) good = false;
+        last = s;
+    }
+    if (f && std::fclose(f) != 0) good = false;
+    runs.push_back(path);
+    buf.clear();
+}
+
+// fusion k-voies de in (tries) dans out, sans doublon et sans ce qui est
+// dans les fichiers de minus. Rend le nombre d'etats ecrits
+long long LayerFiles::merge(const std::vector<std::string>& in, const std::string& out,
+                            const std::vector<std::string>& minus) {
+    std::vector<std::unique_ptr<Reader>> rd;
+    std::vector<const Cell*> cur;
+    for (const auto& p : in) {
+        rd.emplace_back(new Reader(p, w));
+        cur.push_back(rd.back()->next());
+    }
+    std::vector<std::unique_ptr<Reader>> old;
+    std::vector<const Cell*> oldCur;
+    for (const auto& p : minus) {
+        old.emplace_back(new Reader(p, w));
+        oldCur.push_back(old.back()->next());
+    }
+
+    auto later = [&](int a, int b) { return less(cur[b], cur[a]); };
+    std::priority_queue<int, std::vector<int>, decltype(later)> heap(later);
+    for (std::size_t i = 0; i < cur.size(); ++i) {
+        if (cur[i]) heap.push(i);
+    }
+
+    std::FILE* f = std::fopen(out.c_str(), "wb");
+    if (!f) good = false;
+    std::vector<Cell> last;
+    long long nb = 0;
+    while (!heap.empty()) {
+        int i = heap.top();
+        heap.pop();
+        const Cell* s = cur[i];
+        bool dup = !last.empty() && same(last.data(), s);
+        for (std::size_t k = 0; k < old.size() && !dup; ++k) {
+            while (oldCur[k] && less(oldCur[k], s)) oldCur[k] = old[k]->next();
+            dup = oldCur[k] && same(oldCur[k], s);
+        }
+        if (dup) {
+            nbDropped++;
+        } else {
+            if (f && std::fwrite(s, sizeof(Cell), w, f) != (std::size_t)w) good = false;
+            last.assign(s, s + w);
+            nb++;
+        }
+        cur[i] = rd[i]->next();
+        if (cur[i]) heap.push(i);
+    }
+    if (f && std::fclose(f) != 0) good = false;
+    return nb;
+}
+
+long long LayerFiles::commit(int d) {
+    flush();
+    buf.shrink_to_fit(); // rendu pendant la fusion, repris au prochain add
+    std::error_code ec;
+
+    // trop de runs pour les ouvrir tous : on les fusionne par paquets de FAN
+    while (runs.size() > FAN) {
+        std::vector<std::string> group(runs.begin(), runs.begin() + FAN);
+        std::string path = newRun();
+        merge(group, path, {});
+        for (const auto& p : group) fs::remove(p, ec);
+        runs.erase(runs.begin(), runs.begin() + FAN);
+        runs.push_back(path);
+    }
+
+    std::vector<std::string> minus;
+    if (hasSeen) minus.push_back(root + "/vus");
+    for (int k : loose) minus.push_back(layer(k));
+    long long nb = merge(runs, layer(d), minus);
+    for (const auto& p : runs) fs::remove(p, ec);
+    runs.clear();
+
+    // on garde les 2 dernieres a part (ce sont elles qui attrapent le plus
+    // de doublons), les autres vont dans vus. Les couches restent sur le
+    // disque pour retrouver le chemin
+    loose.push_back(d);
+    if (loose.size() > FOLD) {
+        std::vector<std::string> in;
+        if (hasSeen) in.push_back(root + "/vus");
+        for (std::size_t i = 0; i + 2 < loose.size(); ++i) in.push_back(layer(loose[i]));
+        std::string path = newRun();
+        merge(in, path, {});
+        fs::rename(path, root + "/vus", ec);
+        if (ec) good = false;
+        hasSeen = true;
+        loose.erase(loose.begin(), loose.end() - 2);
+    }
+    buf.reserve(cap * w);
+    nbBytes += nb * w * sizeof(Cell);
+    return good ? nb : -1;
+}
+
+LayerFiles::Reader::Reader(const std::string& path, int width)
+    : f(std::fopen(path.c_str(), "rb")), w(width),
+      buf(std::max<std::size_t>(1, READ_BUF / (width * sizeof(Cell))) * width) {}
+
+LayerFiles::Reader::~Reader() {
+    if (f) std::fclose(f);
+}
+
+const Cell* LayerFiles::Reader::next() {
+    if (pos == len) {
+        if (!f) return nullptr;
+        len = std::fread(buf.data(), sizeof(Cell) * w, buf.size() / w, f) * w;
+        pos = 0;
+        if (len == 0) return nullptr;
+    }
+    const Cell* s = buf.data() + pos;
+    pos += w;
+    return s;
+}
@@ -0,0 +1,80 @@
+#ifndef LAYERFILES_H
+#define LAYERFILES_H
+
+#include "Node.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Couches du BFS sur disque. Un etat = w cases (le joueur puis les caisses
+// triees), toujours la meme taille, donc un fichier c'est juste des etats
+// colles. Une couche = un fichier trie sans doublon.
+// On add() les fils de la couche d en vrac : quand le tampon est plein il
+// est trie et ecrit a part (un run). commit(d) fusionne les runs en
+// enlevant les doublons et ce qui est deja dans les couches d'avant.
+// Avec des poussees le graphe n'est pas symetrique, un etat peut revenir
+// bien apres les couches d-1 et d-2, donc on compare aussi a un fichier
+// "vus" (toutes les vieilles couches fusionnees) qu'on remet a jour toutes
+// les FOLD couches. Tout est dans un sous-dossier a nous, efface a la
+// destruction
+class LayerFiles {
+public:
+    // budget = octets de RAM pour le tampon + les lectures pendant la fusion
+    LayerFiles(const std::string& dir, int w, std::size_t budget);
+    ~LayerFiles();
+
+    LayerFiles(const LayerFiles&) = delete;
+    LayerFiles& operator=(const LayerFiles&) = delete;
+
+    bool ok() const { return good; }
+    int width() const { return w; }
+
+    void add(const Cell* s);
+    // rend le nombre d'etats de la couche d (-1 si erreur d'ecriture)
+    long long commit(int d);
+    std::string layer(int d) const;
+
+    long long dropped() const { return nbDropped; } // doublons enleves
+    long long bytes() const { return nbBytes; }     // taille des couches
+
+    // lecture dans l'ordre du fichier, next() rend nullptr a la fin.
+    // Le pointeur reste bon jusqu'au next() suivant
+    class Reader {
+    public:
+        Reader(const std::string& path, int w);
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        const Cell* next();
+
+    private:
+        std::FILE* f;
+        int w;
+        std::vector<Cell> buf;
+        std::size_t pos = 0, len = 0;
+    };
+
+private:
+    std::string root;
+    int w;
+    bool good = true;
+    std::size_t cap;       // etats dans le tampon
+    std::vector<Cell> buf;
+    std::vector<std::string> runs;
+    std::vector<int> loose; // couches pas encore dans vus
+    bool hasSeen = false;
+    int nbRuns = 0;        // pour nommer les runs
+    long long nbDropped = 0;
+    long long nbBytes = 0;
+
+    bool less(const Cell* a, const Cell* b) const;
+    bool same(const Cell* a, const Cell* b) const;
+    std::string newRun();
+    void flush();
+    long long merge(const std::vector<std::string>& in, const std::string& out,
+                    const std::vector<std::string>& minus);
+};
+
+#endif // LAYERFILES_H
@@ -0,0 +1,36 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+
+// Boite aux lettres sans verrou : plusieurs threads deposent des paquets,
+// un seul (le proprietaire) les recupere tous d'un coup.
+// B doit avoir un champ B* next, c'est une pile de Treiber
+template <typename B>
+class Mailbox {
+public:
+    Mailbox() = default;
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+
+    ~Mailbox() {
+        for (B* b = take(); b; ) {
+            B* n = b->next;
+            delete b;
+            b = n;
+        }
+    }
+
+    void post(B* b) {
+        b->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed)) {}
+    }
+
+    // Tous les paquets en attente (le plus recent d'abord), nullptr si rien
+    B* take() { return head.exchange(nullptr, std::memory_order_acquire); }
+
+private:
+    std::atomic<B*> head{nullptr};
+};
+
+#endif // MAILBOX_H
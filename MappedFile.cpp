@@ -0,0 +1,164 @@
+#include "MappedFile.h"
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+uint64_t mix(uint64_t h, uint64_t v)
+{
+    return (h ^ v) * 1099511628211ULL;
+}
+
+#ifdef _WIN32
+uint64_t idOf(uint64_t size, const FILETIME& created, const FILETIME& written)
+{
+    uint64_t h = 1469598103934665603ULL;
+    h = mix(h, size);
+    h = mix(h, ((uint64_t)created.dwHighDateTime << 32) | created.dwLowDateTime);
+    h = mix(h, ((uint64_t)written.dwHighDateTime << 32) | written.dwLowDateTime);
+    return h ? h : 1;
+}
+#else
+uint64_t idOf(const struct stat& sb)
+{
+    uint64_t h = 1469598103934665603ULL;
+    h = mix(h, sb.st_dev);
+    h = mix(h, sb.st_ino);
+    h = mix(h, sb.st_size);
+    h = mix(h, sb.st_mtime);
+    return h ? h : 1;
+}
+#endif
+
+} // namespace
+
+bool MappedFile::open(const std::string& path)
+{
+    this->close();
+
+#ifdef _WIN32
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (f == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(f, &sz) || sz.QuadPart == 0)
+    {
+        CloseHandle(f);
+        return false;
+    }
+
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m == nullptr)
+    {
+        CloseHandle(f);
+        return false;
+    }
+
+    void* p = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (p == nullptr)
+    {
+        CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+
+    BY_HANDLE_FILE_INFORMATION info;
+    if (GetFileInformationByHandle(f, &info))
+        this->m_id = idOf((uint64_t)sz.QuadPart, info.ftCreationTime, info.ftLastWriteTime);
+
+    this->m_file = f;
+    this->m_mapping = m;
+    this->m_data = (const uint8_t*)p;
+    this->m_size = (std::size_t)sz.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* p = mmap(nullptr, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // le mapping reste valide apres le close
+    if (p == MAP_FAILED)
+        return false;
+
+    this->m_data = (const uint8_t*)p;
+    this->m_size = sb.st_size;
+    this->m_id = idOf(sb);
+#endif
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (this->m_data == nullptr)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile((void*)this->m_data);
+    CloseHandle(this->m_mapping);
+    CloseHandle(this->m_file);
+    this->m_mapping = nullptr;
+    this->m_file = nullptr;
+#else
+    munmap((void*)this->m_data, this->m_size);
+#endif
+
+    this->m_data = nullptr;
+    this->m_size = 0;
+    this->m_id = 0;
+}
+
+uint64_t MappedFile::identity(const std::string& path)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA a;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &a))
+        return 0;
+    return idOf(((uint64_t)a.nFileSizeHigh << 32) | a.nFileSizeLow, a.ftCreationTime, a.ftLastWriteTime);
+#else
+    struct stat sb;
+    if (stat(path.c_str(), &sb) != 0)
+        return 0;
+    return idOf(sb);
+#endif
+}
+
+std::string MappedFile::tempName(const std::string& path)
+{
+    static std::atomic<unsigned> counter(0);
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    unsigned long pid = getpid();
+#endif
+    return path + "." + std::to_string(pid) + "-" + std::to_string(counter++) + ".tmp";
+}
+
+bool MappedFile::replace(const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+    // rename n'ecrase pas sous Windows, et remove puis rename laisse un trou
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
@@ -0,0 +1,53 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Fichier ouvert en lecture seule et projete en memoire (mmap sous Linux,
+// MapViewOfFile sous Windows). Les caches sur disque le lisent directement
+// sans tout recopier
+class MappedFile
+{
+    public:
+        MappedFile() = default;
+        ~MappedFile() { this->close(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string& path);
+        void close();
+
+        const uint8_t* data() const { return this->m_data; }
+        std::size_t size() const { return this->m_size; }
+        bool isOpen() const { return this->m_data != nullptr; }
+
+        // Identite du fichier projete (prise a open, 0 si rien d'ouvert) et
+        // celle du fichier qui est sous path maintenant (0 s'il n'y en a pas),
+        // sans l'ouvrir : un seul stat. Elles different des que path a ete
+        // remplace (replace) depuis open. Sous Linux c'est l'inode, qui ne
+        // peut pas etre reutilise tant qu'on garde l'ancien projete ; sous
+        // Windows la taille et les dates (au 100 ns)
+        uint64_t identity() const { return this->m_id; }
+        static uint64_t identity(const std::string& path);
+
+        // Pour ecrire un cache : on ecrit dans tempName(path) (unique par
+        // process et par appel), puis replace le met a la place de path d'un
+        // coup. Les autres process voient l'ancien fichier ou le nouveau,
+        // jamais un fichier a moitie ecrit ni pas de fichier du tout
+        static std::string tempName(const std::string& path);
+        static bool replace(const std::string& from, const std::string& to);
+
+    private:
+        const uint8_t* m_data = nullptr;
+        std::size_t m_size = 0;
+        uint64_t m_id = 0;
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#endif
+};
+
+#endif // MAPPEDFILE_H
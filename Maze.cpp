@@ -1,9 +1,12 @@
 #include "Maze.h"
+#ifndef SOKOBAN_HEADLESS
 #include "GraphicAllegro5.h"
+#endif
 #include <fstream>
 #include <exception>
 
 Maze::Maze(const std::string& levelPath)
+    : m_path(levelPath)
 {
     std::vector<std::string> lines;
     std::string line;
@@ -39,6 +42,11 @@ Maze::Maze(const std::string& levelPath)
                         {
                             this->m_field[i][j].sprite = SpriteType::GOAL;
                         }
+                        else
+                        {
+                            // sinon la case de depart reste bloquee pour les caisses
+                            this->m_field[i][j].sprite = SpriteType::GROUND;
+                        }
                     }
                 }
                 else
@@ -195,6 +203,7 @@ bool Maze::updatePlayer(char dir)
     return false;
 }
 
+#ifndef SOKOBAN_HEADLESS
 void Maze::playSolution(GraphicAllegro5& g, const std::vector<char>& movesSolution)
 {
     for (const auto& move : movesSolution)
@@ -205,6 +214,7 @@ void Maze::playSolution(GraphicAllegro5& g, const std::vector<char>& movesSoluti
         g.display();
     }
 }
+#endif
 
 std::vector<std::pair<int, int>> Maze::getBoxes() const
 {
@@ -239,28 +249,65 @@ std::vector<std::pair<int, int>> Maze::getGoals() const
 }
 
 void Maze::computeStaticDeadlocks() {
-    // Initialise la matrice  "false" partout
+    // Initialise la matrice a "false" partout
     m_deadlocks.assign(m_lig, std::vector<bool>(m_col, false));
 
-    for (unsigned int i = 0; i < m_lig; ++i) {
-        for (unsigned int j = 0; j < m_col; ++j) {
-            // Un mur ou un objectif ne peut pas tre une case morte
-            if (isWall({i, j}) || isGoal({i, j})) continue;
+    auto inside = [&](int i, int j) {
+        return i >= 0 && i < (int)m_lig && j >= 0 && j < (int)m_col;
+    };
+    auto floor = [&](int i, int j) {
+        return inside(i, j) && !isWall({i, j});
+    };
+
+    // 1. Cases que le joueur peut atteindre (sans tenir compte des caisses) :
+    // on ne marque que l'interieur, pas le vide autour du niveau
+    std::vector<std::vector<bool>> inner(m_lig, std::vector<bool>(m_col, false));
+    std::vector<std::pair<int, int>> todo = {m_playerPosition};
+    inner[m_playerPosition.first][m_playerPosition.second] = true;
+    while (!todo.empty()) {
+        auto cur = todo.back();
+        todo.pop_back();
+        for (const auto& d : neighbours) {
+            int i = cur.first + d.first, j = cur.second + d.second;
+            if (!floor(i, j) || inner[i][j]) continue;
+            inner[i][j] = true;
+            todo.push_back({i, j});
+        }
+    }
 
-            // Vrification des murs adjacents (Haut, Bas, Gauche, Droite)
-            bool wT = isWall({i - 1, j});
-            bool wB = isWall({i + 1, j});
-            bool wL = isWall({i, j - 1});
-            bool wR = isWall({i, j + 1});
+    // 2. On tire une caisse virtuelle depuis tous les goals en meme temps :
+    // la caisse en (i, j) peut etre tiree vers (i, j) + d si le joueur a la
+    // place d'y etre et de reculer encore d'une case. Toute case atteinte
+    // peut etre poussee jusqu'a un goal, les autres sont mortes.
+    // Un seul parcours pour tout le niveau, donc O(cases)
+    std::vector<std::vector<bool>> live(m_lig, std::vector<bool>(m_col, false));
+    todo.clear();
+    for (const auto& gl : getGoals()) {
+        live[gl.first][gl.second] = true;
+        todo.push_back(gl);
+    }
+    while (!todo.empty()) {
+        auto cur = todo.back();
+        todo.pop_back();
+        for (const auto& d : neighbours) {
+            int i = cur.first + d.first, j = cur.second + d.second;
+            if (!floor(i, j) || !floor(i + d.first, j + d.second)) continue;
+            if (live[i][j]) continue;
+            live[i][j] = true;
+            todo.push_back({i, j});
+        }
+    }
 
-            // Si la case est un coin (deux murs perpendiculaires)
-            if ((wT && wL) || (wT && wR) || (wB && wL) || (wB && wR)) {
+    for (unsigned int i = 0; i < m_lig; ++i) {
+        for (unsigned int j = 0; j < m_col; ++j) {
+            if (inner[i][j] && !live[i][j]) {
                 m_deadlocks[i][j] = true;
             }
         }
     }
 }
 
+#ifndef SOKOBAN_HEADLESS
 void Maze::draw(GraphicAllegro5& g) const {
     for (unsigned int i = 0; i < this->m_field.size(); ++i) {
         for (unsigned int j = 0; j < this->m_field[i].size(); ++j) {
@@ -288,3 +335,4 @@ void Maze::draw(GraphicAllegro5& g) const {
     // 3. Enfin le joueur
     g.drawT(g.getSpritePlayer(this->m_playerDirection), this->m_playerPosition.second, this->m_playerPosition.first);
 }
+#endif
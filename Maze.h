@@ -3,7 +3,10 @@
 
 #include <string>
 #include <vector>
+// SOKOBAN_HEADLESS : pas d'Allegro (batch), playSolution et draw n'existent pas
+#ifndef SOKOBAN_HEADLESS
 #include "GraphicAllegro5.h"
+#endif
 
 // Max size for the field
 #define NB_MAX_WIDTH     100
@@ -45,6 +48,7 @@ class Maze
         std::vector<std::vector<Square>> m_field;
         std::pair<int, int> m_playerPosition;
         std::vector<std::vector<bool>> m_deadlocks;
+        std::string m_path;
         unsigned int m_lig = 0, m_col = 0; // size of field
         char m_playerDirection = RIGHT;
 
@@ -76,6 +80,7 @@ class Maze
         unsigned int getNbCols() const { return this->m_col; }
 
         const std::pair<int, int>& getPlayerPosition() const { return this->m_playerPosition; }
+        const std::string& getPath() const { return this->m_path; }
 
         void computeStaticDeadlocks();
         bool isDeadlock(const std::pair<int, int>& pos) const {
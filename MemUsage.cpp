@@ -0,0 +1,62 @@
+#include "MemUsage.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+namespace MemUsage
+{
+
+#ifdef _WIN32
+
+std::size_t current()
+{
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0;
+    return pmc.WorkingSetSize;
+}
+
+std::size_t peak()
+{
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0;
+    return pmc.PeakWorkingSetSize;
+}
+
+#else
+
+std::size_t peak()
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return 0;
+#ifdef __APPLE__
+    return ru.ru_maxrss;        // deja en octets
+#else
+    return ru.ru_maxrss * 1024; // en Ko sous Linux
+#endif
+}
+
+std::size_t current()
+{
+    // 2e champ de statm = pages en memoire
+    long pages = 0, resident = 0;
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (f == nullptr)
+        return peak(); // pas de /proc, le pic est ce qu'on a de mieux
+    if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2)
+        resident = 0;
+    std::fclose(f);
+    return (std::size_t)resident * sysconf(_SC_PAGESIZE);
+}
+
+#endif
+
+}
@@ -0,0 +1,14 @@
+#ifndef MEMUSAGE_H
+#define MEMUSAGE_H
+
+#include <cstddef>
+
+// Memoire physique utilisee par le process (RSS / working set), en octets.
+// Sert aux budgets memoire et aux stats du batch
+namespace MemUsage
+{
+    std::size_t current();
+    std::size_t peak(); // max depuis le lancement du process
+}
+
+#endif // MEMUSAGE_H
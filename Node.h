@@ -2,23 +2,64 @@
 #define NODE_H
 
 #include <vector>
-#include <set>
-#include <string>
+#include <algorithm>
 #include <utility>
 #include <functional>
+#include <cstdint>
+#include <cstring>
+#include <random>
 
+// Une case = lig * nbCols + col (100x100 max donc ca tient sur 16 bits)
+typedef uint16_t Cell;
+// Un noeud = son indice dans le NodeStore
+typedef uint32_t NodeId;
 
-struct pair_hash {
-    template <class T1, class T2>
-    std::size_t operator()(const std::pair<T1, T2>& p) const {
-        return std::hash<int>{}(p.first) ^ (std::hash<int>{}(p.second) << 1);
+const Cell NO_CELL = 0xFFFF;
+const NodeId NO_NODE = 0xFFFFFFFF;
+
+// Flags d'une case dans la table plate du Solver
+enum CellFlag : uint8_t {
+    C_WALL = 1,
+    C_GOAL = 2,
+    C_DEAD = 4,  // deadlock statique
+    C_FLOOR = 8, // sol (goal ou pas)
+    C_TUNNEL_V = 16, // couloir de 1 de large, murs a gauche et a droite
+    C_TUNNEL_H = 32, // pareil avec murs en haut et en bas
+};
+
+// Table de Zobrist du niveau : une cle aleatoire par (case, caisse) et par
+// (case, joueur). Le hash d'un etat = XOR des cles, donc une poussee c'est
+// juste quelques XOR au lieu de tout rehacher
+struct Zobrist {
+    std::vector<uint64_t> box;
+    std::vector<uint64_t> player;
+
+    void init(int nbCells) {
+        std::mt19937_64 rng(0x50C0BA17); // graine fixe pour avoir des runs reproductibles
+        box.resize(nbCells);
+        player.resize(nbCells);
+        for (int i = 0; i < nbCells; ++i) {
+            box[i] = rng();
+            player[i] = rng();
+        }
+    }
+
+    uint64_t of(Cell p, const Cell* b, int n) const {
+        uint64_t h = player[p];
+        for (int i = 0; i < n; ++i) h ^= box[b[i]];
+        return h;
     }
 };
 
+// Infos d'un etat. Les caisses sont rangees a part dans l'arene du NodeStore,
+// et on garde juste le parent + le dernier coup au lieu du chemin complet
 struct Node {
-    std::pair<int, int> playerPos;
-    std::set<std::pair<int, int>> boxes; // On garde le set pour pas que �a bug
-    std::string path;
+    Cell playerPos = 0;
+    uint16_t goals = 0;      // nb de caisses sur un goal, tenu a jour a chaque poussee
+    char move = -1;          // coup qui a mene ici (TOP, BOTTOM, ...)
+    bool stale = false;      // h n'est qu'un minorant, a recalculer a la sortie de la file
+    NodeId parent = NO_NODE;
+    uint64_t hash = 0;       // Zobrist, mis a jour a chaque coup
 
     // g(n) et h(n)
     int cost = 0;
@@ -26,49 +67,260 @@ struct Node {
 
     // calcul de f direct
     int f() const { return cost + heuristic; }
+};
+
+// Un successeur avant d'etre mis dans le store
+struct Succ {
+    Cell player;
+    char move;
+    Cell from = NO_CELL; // caisse poussee (NO_CELL si simple pas)
+    Cell to = NO_CELL;
+    int pushes = 1;      // > 1 pour un macro-coup (tunnel, salle des goals)
+};
+
+// Un seul etat modifie sur place (brute force) : make joue un coup, unmake
+// le defait, pas de copie d'une profondeur a l'autre
+struct State {
+    Cell player = 0;
+    std::vector<Cell> boxes; // triees
+    uint64_t hash = 0;
+    int goals = 0;
 
-    // Pour comparer deux nodes dans le set des vues
-    bool operator<(const Node& other) const {
-        if (playerPos != other.playerPos)
-            return playerPos < other.playerPos;
-        return boxes < other.boxes;
+    void init(Cell p, const std::vector<Cell>& b, const Zobrist& z, const uint8_t* flags) {
+        player = p;
+        boxes = b;
+        std::sort(boxes.begin(), boxes.end());
+        hash = z.of(p, boxes.data(), boxes.size());
+        goals = 0;
+        for (Cell c : boxes) goals += (flags[c] & C_GOAL) ? 1 : 0;
     }
 
-    // Pour tester l'�galit�
-    bool operator==(const Node& other) const {
-        return playerPos == other.playerPos && boxes == other.boxes;
+    void make(const Succ& x, const Zobrist& z, const uint8_t* flags) {
+        move(x.player, x.from, x.to, z, flags);
+    }
+    // prev = case du joueur avant le coup
+    void unmake(const Succ& x, Cell prev, const Zobrist& z, const uint8_t* flags) {
+        move(prev, x.to, x.from, z, flags);
     }
+
+private:
+    void move(Cell p, Cell from, Cell to, const Zobrist& z, const uint8_t* flags);
 };
 
-struct NodeHash {
-    std::size_t operator()(const Node& n) const {
-        std::size_t seed = 0;
+// Stockage contigu de tous les noeuds d'une recherche.
+// Chaque noeud a nbBoxes cases triees dans l'arene, donc pas d'allocation
+// par noeud et la comparaison c'est un memcmp.
+// Si withAssign, on garde aussi pour chaque caisse le goal qui lui est
+// affecte par l'heuristique (meme ordre que les caisses)
+class NodeStore {
+public:
+    NodeStore(int nbBoxes, const Zobrist* zob, const uint8_t* cellFlags, bool withAssign = false)
+        : nb(nbBoxes), nbAssign(withAssign ? nbBoxes : 0), z(zob), flags(cellFlags) {}
+
+    int nbBoxes() const { return nb; }
+    std::size_t size() const { return infos.size(); }
+
+    Node& at(NodeId id) { return infos[id]; }
+    const Node& at(NodeId id) const { return infos[id]; }
+    const Cell* boxes(NodeId id) const { return arena.data() + (std::size_t)id * nb; }
+    uint16_t* assign(NodeId id) { return nbAssign ? goalOf.data() + (std::size_t)id * nbAssign : nullptr; }
 
-        // 1. Hacher la position du joueur (avec la formule robuste)
-        auto hPlayer = pair_hash{}(n.playerPos);
-        seed ^= hPlayer + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    // Noeud de depart (les caisses sont triees ici)
+    NodeId root(Cell player, std::vector<Cell> b) {
+        std::sort(b.begin(), b.end());
+        arena.insert(arena.end(), b.begin(), b.end());
+        goalOf.resize(goalOf.size() + nbAssign, 0);
+        Node n;
+        n.playerPos = player;
+        n.hash = z->of(player, b.data(), nb);
+        for (Cell c : b) n.goals += (flags[c] & C_GOAL) ? 1 : 0;
+        infos.push_back(n);
+        return infos.size() - 1;
+    }
 
-        // 2. Hacher les boites
-        for(const auto& box : n.boxes) {
-            auto hBox = pair_hash{}(box);
-            // C'est cette ligne qui fait toute la différence :
-            seed ^= hBox + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    // Fils de parent : le joueur va en player, et si from != NO_CELL
+    // la caisse en from est poussee en to (le tableau reste trie)
+    NodeId push(NodeId parent, Cell player, char move, Cell from = NO_CELL, Cell to = NO_CELL) {
+        std::size_t base = arena.size();
+        arena.resize(base + nb);
+        Cell* dst = arena.data() + base;
+        std::memcpy(dst, arena.data() + (std::size_t)parent * nb, nb * sizeof(Cell));
+        uint16_t* a = nullptr;
+        if (nbAssign) {
+            goalOf.resize(base + nb);
+            a = goalOf.data() + base;
+            std::memcpy(a, goalOf.data() + (std::size_t)parent * nb, nb * sizeof(uint16_t));
+        }
+        const Node& p = infos[parent];
+        uint64_t h = p.hash ^ z->player[p.playerPos] ^ z->player[player];
+        int goals = p.goals;
+        if (from != NO_CELL) {
+            moveBox(dst, nb, from, to, a);
+            h ^= z->box[from] ^ z->box[to];
+            goals += ((flags[to] & C_GOAL) ? 1 : 0) - ((flags[from] & C_GOAL) ? 1 : 0);
         }
-        return seed;
+
+        Node n;
+        n.playerPos = player;
+        n.move = move;
+        n.parent = parent;
+        n.hash = h;
+        n.goals = goals;
+        n.cost = p.cost + 1;
+        infos.push_back(n);
+        return infos.size() - 1;
     }
+
+    NodeId push(NodeId parent, const Succ& s) {
+        NodeId id = push(parent, s.player, s.move, s.from, s.to);
+        infos[id].cost += s.pushes - 1;
+        return id;
+    }
+
+    // Enleve le dernier noeud (doublon ou backtrack)
+    void pop() {
+        infos.pop_back();
+        arena.resize(arena.size() - nb);
+        goalOf.resize(goalOf.size() - nbAssign);
+    }
+
+    bool same(NodeId a, NodeId b) const {
+        // on compare les caisses seulement si les hash sont egaux
+        return infos[a].hash == infos[b].hash
+            && infos[a].playerPos == infos[b].playerPos
+            && std::memcmp(boxes(a), boxes(b), nb * sizeof(Cell)) == 0;
+    }
+
+    // On remonte les parents pour refaire la liste des coups
+    std::vector<char> path(NodeId id) const {
+        std::vector<char> r;
+        for (NodeId cur = id; infos[cur].parent != NO_NODE; cur = infos[cur].parent)
+            r.push_back(infos[cur].move);
+        std::reverse(r.begin(), r.end());
+        return r;
+    }
+
+    // Deplace une caisse dans un tableau trie sans le retrier en entier
+    // (extra, s'il y en a un, suit les memes echanges)
+    static void moveBox(Cell* b, int n, Cell from, Cell to, uint16_t* extra = nullptr) {
+        int i = 0;
+        while (i < n && b[i] != from) ++i;
+        if (i == n) return;
+        b[i] = to;
+        while (i > 0 && b[i - 1] > b[i]) {
+            std::swap(b[i - 1], b[i]);
+            if (extra) std::swap(extra[i - 1], extra[i]);
+            --i;
+        }
+        while (i + 1 < n && b[i + 1] < b[i]) {
+            std::swap(b[i + 1], b[i]);
+            if (extra) std::swap(extra[i + 1], extra[i]);
+            ++i;
+        }
+    }
+
+private:
+    int nb;
+    int nbAssign;
+    const Zobrist* z;
+    const uint8_t* flags;
+    std::vector<Cell> arena;
+    std::vector<uint16_t> goalOf;
+    std::vector<Node> infos;
 };
 
-// Comparateur pour les priority queue
-struct NodeComparator {
-    bool operator()(const Node& a, const Node& b) const {
-        return a.f() > b.f(); // A* : le plus petit f en premier
+// Ensemble des etats deja vus : une table plate (adressage ouvert, sondage
+// lineaire) de NodeId avec le bas de leur hash, les caisses sont lues dans
+// le store. 8 octets par case au lieu d'un noeud alloue par etat, et
+// surtout la liberer a la fin (ou quand on arrete) coute un seul free : un
+// unordered_set de quelques millions d'etats mettait des centaines de ms.
+// Grace au hash garde, agrandir la table ne relit pas le store.
+// Pas d'effacement : pour remplacer un etat par un chemin plus court on
+// ecrit le nouvel id dans la case (*it = id).
+class VisitedSet {
+public:
+    explicit VisitedSet(const NodeStore* st, std::size_t n = 1024) : st(st) {
+        std::size_t cap = 16;
+        while (cap < n * 2) cap *= 2;
+        slots.assign(cap, Slot{NO_NODE, 0});
+    }
+
+    // case de l'etat egal a id, ou end()
+    NodeId* find(NodeId id) {
+        return find(st->at(id).hash, [&](NodeId o) { return st->same(o, id); });
+    }
+    // pareil pour un etat qui n'est pas (encore) dans le store : eq(o) dit
+    // si o est le meme etat
+    template <class Eq>
+    NodeId* find(uint64_t hash, Eq eq) {
+        uint32_t h = (uint32_t)hash;
+        for (std::size_t i = h & (slots.size() - 1);; i = (i + 1) & (slots.size() - 1)) {
+            if (slots[i].id == NO_NODE) return end();
+            if (slots[i].h == h && eq(slots[i].id)) return &slots[i].id;
+        }
+    }
+    NodeId* end() { return nullptr; }
+
+    // comme unordered_set::insert : la case, et faux si l'etat y etait deja
+    std::pair<NodeId*, bool> insert(NodeId id) {
+        NodeId* it = find(id);
+        if (it) return {it, false};
+        return {add(id), true};
+    }
+    // sans chercher : id ne doit pas y etre
+    NodeId* add(NodeId id) {
+        if ((nb + 1) * 2 > slots.size()) grow();
+        nb++;
+        return &place({id, (uint32_t)st->at(id).hash})->id;
+    }
+
+    std::size_t size() const { return nb; }
+
+private:
+    struct Slot {
+        NodeId id;
+        uint32_t h; // bas du hash
+    };
+    const NodeStore* st;
+    std::vector<Slot> slots;
+    std::size_t nb = 0;
+
+    Slot* place(Slot s) {
+        std::size_t i = s.h & (slots.size() - 1);
+        while (slots[i].id != NO_NODE) i = (i + 1) & (slots.size() - 1);
+        slots[i] = s;
+        return &slots[i];
+    }
+    void grow() {
+        std::vector<Slot> old(slots.size() * 2, Slot{NO_NODE, 0});
+        old.swap(slots);
+        for (const Slot& s : old) {
+            if (s.id != NO_NODE) place(s);
+        }
     }
 };
 
-struct GreedyNodeComparator {
-    bool operator()(const Node& a, const Node& b) const {
-        return a.heuristic > b.heuristic; // Greedy : on regarde que h
+// Comparateur pour les priority queue (HDA*, bidir) : le plus petit f, et a
+// f egal le plus petit h (le plus profond). Sur les gros plateaux de f ca
+// evite de developper toute la largeur
+struct DeepNodeComparator {
+    const NodeStore* st;
+    bool operator()(NodeId a, NodeId b) const {
+        const Node& x = st->at(a);
+        const Node& y = st->at(b);
+        if (x.f() != y.f()) return x.f() > y.f();
+        if (x.heuristic != y.heuristic) return x.heuristic > y.heuristic;
+        return a < b; // puis le plus recent
     }
 };
 
+inline void State::move(Cell p, Cell from, Cell to, const Zobrist& z, const uint8_t* flags) {
+    hash ^= z.player[player] ^ z.player[p];
+    player = p;
+    if (from == NO_CELL) return;
+    NodeStore::moveBox(boxes.data(), boxes.size(), from, to);
+    hash ^= z.box[from] ^ z.box[to];
+    goals += ((flags[to] & C_GOAL) ? 1 : 0) - ((flags[from] & C_GOAL) ? 1 : 0);
+}
+
 #endif // NODE_H
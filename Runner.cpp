@@ -0,0 +1,74 @@
+#include "Runner.h"
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace Runner
+{
+
+const char* const ALGOS = "bfs dfs astar greedy ida bidir bf pbfs ebfs hda ara portfolio";
+
+bool run(Solver& s, const std::string& algo, int threads, std::vector<char>& sol)
+{
+    if (algo == "bfs") sol = s.solveBFS();
+    else if (algo == "dfs") sol = s.solveDFS();
+    else if (algo == "astar") sol = s.solveAStar();
+    else if (algo == "greedy") sol = s.solveBestFirst();
+    else if (algo == "ida") sol = s.solveIDAStar();
+    else if (algo == "bidir") sol = s.solveBidirectional();
+    else if (algo == "bf") sol = s.solveBruteForce(threads);
+    else if (algo == "pbfs") sol = s.solveBFSParallel(threads);
+    else if (algo == "ebfs") sol = s.solveBFSExternal();
+    else if (algo == "hda") sol = s.solveAStarParallel(threads);
+    else if (algo == "ara") sol = s.solveAnytime();
+    else if (algo == "portfolio") sol = s.solvePortfolio();
+    else return false;
+    return true;
+}
+
+std::unique_ptr<Maze> load(const std::string& path)
+{
+    // Maze ne sait pas dire qu'un fichier manque, et jette si le niveau est trop grand
+    std::unique_ptr<Maze> m;
+    try {
+        if (std::ifstream(path).peek() != EOF) m.reset(new Maze(path));
+    } catch (const std::exception&) {
+    }
+    return m;
+}
+
+bool replay(const std::string& path, const std::vector<char>& sol, std::string& lurd)
+{
+    Maze m(path);
+    const char* letters = "udlr";
+    for (char d : sol) {
+        if (d < 0 || d >= DIRECTION_MAX) return false;
+        std::pair<int, int> p = m.getPlayerPosition();
+        p.first += neighbours[d].first;
+        p.second += neighbours[d].second;
+        bool push = m.isBox(p);
+        lurd += push ? (char)(letters[(int)d] - 'a' + 'A') : letters[(int)d];
+        m.updatePlayer(d);
+    }
+    return m.isSolution();
+}
+
+void addLevels(const std::string& arg, std::vector<std::string>& levels)
+{
+    if (!fs::is_directory(arg)) {
+        levels.push_back(arg);
+        return;
+    }
+    // dans l'ordre pour que les runs se comparent
+    std::vector<std::string> lv;
+    for (const auto& e : fs::directory_iterator(arg)) {
+        if (e.is_regular_file() && e.path().extension() == ".txt") lv.push_back(e.path().string());
+    }
+    std::sort(lv.begin(), lv.end());
+    levels.insert(levels.end(), lv.begin(), lv.end());
+}
+
+}
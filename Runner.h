@@ -0,0 +1,31 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include "Maze.h"
+#include "Solver.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Ce que les cibles en ligne de commande (batch, bench) ont en commun
+namespace Runner
+{
+    // noms acceptes par run, separes par des espaces
+    extern const char* const ALGOS;
+
+    // Lance l'algo algo sur s (threads pour bf, pbfs et hda). false si le
+    // nom est inconnu
+    bool run(Solver& s, const std::string& algo, int threads, std::vector<char>& sol);
+
+    // nullptr si le fichier manque ou si le niveau est trop grand
+    std::unique_ptr<Maze> load(const std::string& path);
+
+    // Rejoue sol sur un niveau tout neuf : donne le LURD (udlr, en majuscule
+    // quand on pousse) et dit si le niveau est fini
+    bool replay(const std::string& path, const std::vector<char>& sol, std::string& lurd);
+
+    // arg = un niveau ou un dossier (tous ses .txt, tries)
+    void addLevels(const std::string& arg, std::vector<std::string>& levels);
+}
+
+#endif // RUNNER_H
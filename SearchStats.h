@@ -0,0 +1,31 @@
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+#include <functional>
+#include <string>
+
+// Compteurs d'une recherche, remplis par tous les solve* du Solver
+struct SearchStats {
+    long long expanded = 0;   // noeuds developpes
+    long long generated = 0;  // successeurs produits
+    long long duplicates = 0; // successeurs deja vus
+    long long deadlocks = 0;  // successeurs morts (freeze, motifs)
+    long long openPeak = 0;   // taille max de la file (de la pile / du chemin pour IDA* et BF)
+    long long closed = 0;     // etats dans le vu a la fin
+
+    // temps par phase en s : preparation (motifs morts, h de depart),
+    // recherche, puis reconstruction de la solution
+    double tInit = 0;
+    double tSearch = 0;
+    double tPath = 0;
+
+    // portfolio : la variante qui a produit ces compteurs ("" sinon)
+    std::string variant;
+
+    double total() const { return tInit + tSearch + tPath; }
+};
+
+// appele pendant la recherche avec l'etat des compteurs
+typedef std::function<void(const SearchStats&)> ProgressFn;
+
+#endif // SEARCHSTATS_H
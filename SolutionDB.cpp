@@ -0,0 +1,229 @@
+#include "SolutionDB.h"
+#include "Maze.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint32_t DB_VERSION = 2;
+const int LOCK_TRIES = 200;        // x 10 ms
+const int LOCK_STALE = 30;         // s, verrou oublie par un process mort
+
+} // namespace
+
+SolutionDB::SolutionDB(const std::string& p) : path(p) {
+    attach();
+}
+
+uint64_t SolutionDB::keyOf(const Maze& m) {
+    uint64_t key = 1469598103934665603ULL;
+    auto mix = [&](uint64_t v) { key = (key ^ v) * 1099511628211ULL; };
+    mix(m.getNbLines());
+    mix(m.getNbCols());
+    for (unsigned i = 0; i < m.getNbLines(); ++i) {
+        for (unsigned j = 0; j < m.getNbCols(); ++j) {
+            std::pair<int, int> p(i, j);
+            mix((m.isWall(p) ? 1 : 0) | (m.isGoal(p) ? 2 : 0) | (m.isBox(p) ? 4 : 0)
+                | (p == m.getPlayerPosition() ? 8 : 0));
+        }
+    }
+    return key;
+}
+
+SolutionDB::Class SolutionDB::classify(const std::string& algo, bool push, Heuristic::Type h, bool corral,
+                                       bool macros) {
+    // le PI-corral et les macro-coups font perdre l'optimalite, Bidir est
+    // toujours en poussees mais s'arrete au premier croisement
+    Class opt = push ? OPT_PUSHES : OPT_MOVES;
+    if (corral || macros) return ANY;
+    if (algo == "bfs" || algo == "pbfs" || algo == "ebfs" || algo == "bf") return opt;
+    // l'affectation gloutonne peut surestimer
+    if (algo == "astar" || algo == "ida" || algo == "hda") return h == Heuristic::GREEDY_MATCH ? ANY : opt;
+    return ANY;
+}
+
+void SolutionDB::attach() {
+    recs = nullptr;
+    moves = nullptr;
+    count = 0;
+    gen = 0;
+    if (!file.open(path)) {
+        seen = MappedFile::identity(path); // vide ou absent : pas la peine de reessayer a chaque fois
+        return;
+    }
+    seen = file.identity();
+    const Header* h = (const Header*)file.data();
+    if (file.size() < sizeof(Header) || std::string(h->magic, 4) != "SKSO" || h->version != DB_VERSION
+        || file.size() < sizeof(Header) + h->count * sizeof(Rec)) {
+        file.close();
+        return;
+    }
+    recs = (const Rec*)(file.data() + sizeof(Header));
+    moves = (const char*)(recs + h->count);
+    count = h->count;
+    gen = h->gen;
+    // une entree qui sort du fichier = fichier tronque, on n'en veut pas
+    std::size_t total = file.size() - sizeof(Header) - count * sizeof(Rec);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (recs[i].off + recs[i].len > total) {
+            file.close();
+            recs = nullptr;
+            count = 0;
+            return;
+        }
+    }
+}
+
+// un autre process a pu remplacer le fichier depuis. Un stat suffit : le
+// fichier est toujours remplace d'un coup, jamais modifie sur place, donc
+// son identite (l'inode sous Linux) change a chaque reecriture
+void SolutionDB::refresh() {
+    if (MappedFile::identity(path) != seen) attach();
+}
+
+std::size_t SolutionDB::size() {
+    std::lock_guard<std::mutex> l(mx);
+    refresh();
+    return count;
+}
+
+bool SolutionDB::find(uint64_t key, Class cls, Entry& e) {
+    std::lock_guard<std::mutex> l(mx);
+    refresh();
+    const Rec* end = recs + count;
+    const Rec* it = std::lower_bound(recs, end, key, [](const Rec& r, uint64_t k) { return r.key < k; });
+    const Rec* best = nullptr;
+    for (; it != end && it->key == key; ++it) {
+        if (cls != ANY && it->cls != (uint32_t)cls) continue;
+        if (!best || it->len < best->len) best = it;
+    }
+    if (!best) return false;
+    e.moves.assign(moves + best->off, moves + best->off + best->len);
+    e.cls = (Class)best->cls;
+    e.algo = std::string(best->algo, strnlen(best->algo, sizeof(best->algo)));
+    e.expanded = best->expanded;
+    e.generated = best->generated;
+    e.time = best->time;
+    return true;
+}
+
+bool SolutionDB::lock() const {
+    std::string lk = path + ".lock";
+    for (int i = 0; i < LOCK_TRIES; ++i) {
+#ifdef _WIN32
+        HANDLE h = CreateFileA(lk.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h != INVALID_HANDLE_VALUE) {
+            CloseHandle(h);
+            return true;
+        }
+#else
+        int fd = ::open(lk.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (fd >= 0) {
+            ::close(fd);
+            return true;
+        }
+#endif
+        std::error_code ec;
+        auto t = fs::last_write_time(lk, ec);
+        if (!ec && fs::file_time_type::clock::now() - t > std::chrono::seconds(LOCK_STALE)) {
+            fs::remove(lk, ec);
+            continue;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+void SolutionDB::unlock() const {
+    std::error_code ec;
+    fs::remove(path + ".lock", ec);
+}
+
+bool SolutionDB::store(uint64_t key, Class cls, const std::vector<char>& sol, const std::string& algo,
+                       const SearchStats& st) {
+    if (sol.empty()) return false;
+    std::lock_guard<std::mutex> l(mx);
+    refresh();
+    // place de (key, cls) dans l'index
+    auto slot = [&]() {
+        const Rec* end = recs + count;
+        const Rec* it = std::lower_bound(recs, end, key, [](const Rec& r, uint64_t k) { return r.key < k; });
+        while (it != end && it->key == key && it->cls < (uint32_t)cls) ++it;
+        return it;
+    };
+    // deja aussi bien : pas besoin du verrou
+    const Rec* end = recs + count;
+    const Rec* it = slot();
+    if (it != end && it->key == key && it->cls == (uint32_t)cls && it->len <= sol.size()) return true;
+
+    if (!lock()) return false;
+    attach(); // la derniere version, un autre a pu ecrire entre temps
+    end = recs + count;
+    it = slot();
+    bool replace = it != end && it->key == key && it->cls == (uint32_t)cls;
+    if (replace && it->len <= sol.size()) {
+        unlock();
+        return true;
+    }
+
+    Rec nr = {};
+    nr.key = key;
+    nr.cls = cls;
+    nr.len = sol.size();
+    nr.expanded = st.expanded;
+    nr.generated = st.generated;
+    nr.time = st.total();
+    std::strncpy(nr.algo, algo.c_str(), sizeof(nr.algo) - 1);
+
+    // nouvel index : les anciennes entrees avec la nouvelle a sa place,
+    // les coups sont recopies dans le meme ordre
+    std::vector<Rec> out;
+    std::vector<char> mv;
+    out.reserve(count + 1);
+    std::size_t pos = it - recs;
+    for (std::size_t i = 0; i <= count; ++i) {
+        if (i == pos) {
+            nr.off = mv.size();
+            mv.insert(mv.end(), sol.begin(), sol.end());
+            out.push_back(nr);
+            if (replace) continue;
+        }
+        if (i == count) break;
+        Rec r = recs[i];
+        r.off = mv.size();
+        mv.insert(mv.end(), moves + recs[i].off, moves + recs[i].off + recs[i].len);
+        out.push_back(r);
+    }
+
+    Header h = {{'S', 'K', 'S', 'O'}, DB_VERSION, (uint64_t)out.size(), gen + 1};
+    // on a le verrou, mais un process qui l'aurait cru oublie ecrit peut-etre
+    // encore : chacun son fichier temporaire
+    std::string tmp = MappedFile::tempName(path);
+    bool ok;
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        f.write((const char*)&h, sizeof(h));
+        f.write((const char*)out.data(), out.size() * sizeof(Rec));
+        f.write(mv.data(), mv.size());
+        ok = (bool)f;
+    }
+    file.close(); // Windows : pas de remplacement d'un fichier projete chez nous
+    ok = ok && MappedFile::replace(tmp, path);
+    if (!ok) std::remove(tmp.c_str());
+    unlock();
+    attach();
+    return ok;
+}
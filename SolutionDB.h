@@ -0,0 +1,97 @@
+#ifndef SOLUTIONDB_H
+#define SOLUTIONDB_H
+
+#include "MappedFile.h"
+#include "Heuristic.h"
+#include "SearchStats.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Maze;
+
+// Solutions deja trouvees, sur disque (levels/solutions.db par defaut).
+// Cle = hash du niveau tel quel (murs, goals, caisses, joueur), donc un
+// niveau deplace dans un autre fichier est retrouve, et un niveau ou on a
+// deja bouge le joueur est un autre niveau. Pour chaque cle on garde la
+// meilleure solution par classe : la plus courte en coups, la plus courte
+// en poussees, et n'importe laquelle (la plus courte vue).
+// Le fichier est un index trie projete en memoire (une recherche = une
+// dichotomie), jamais modifie sur place : store() le reecrit a cote sous
+// un verrou (fichier .lock cree en exclusif) puis le met a la place d'un
+// coup (MappedFile::replace), donc plusieurs process peuvent lire et
+// ecrire en meme temps et un lecteur voit toujours l'ancien ou le nouveau.
+// Chaque find() fait juste un stat pour voir si le fichier a ete remplace.
+// En echange chaque store() qui garde une solution recopie tout le fichier :
+// c'est lineaire en la taille de la base par ajout, donc quadratique pour
+// un batch qui remplit une base vide niveau par niveau (ca reste quelques
+// Mo pour des milliers de niveaux)
+class SolutionDB {
+public:
+    enum Class { ANY, OPT_MOVES, OPT_PUSHES };
+
+    struct Entry {
+        std::vector<char> moves;
+        Class cls = ANY;
+        std::string algo;        // qui l'a trouvee
+        long long expanded = 0;
+        long long generated = 0;
+        double time = 0;         // temps de la recherche (s)
+    };
+
+    explicit SolutionDB(const std::string& path = "levels/solutions.db");
+
+    SolutionDB(const SolutionDB&) = delete;
+    SolutionDB& operator=(const SolutionDB&) = delete;
+
+    static uint64_t keyOf(const Maze& m);
+
+    // ce que garantit algo (noms de Runner::ALGOS) avec ces reglages
+    static Class classify(const std::string& algo, bool push, Heuristic::Type h, bool corral, bool macros);
+
+    // ANY : la plus courte toutes classes confondues. Sinon juste cette classe
+    bool find(uint64_t key, Class cls, Entry& e);
+    // garde la solution si elle est meilleure que celle de sa classe.
+    // Faux si le fichier n'a pas pu etre ecrit (verrou pris trop longtemps...)
+    bool store(uint64_t key, Class cls, const std::vector<char>& moves, const std::string& algo,
+               const SearchStats& st);
+
+    std::size_t size();
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t count;
+        uint64_t gen;            // +1 a chaque reecriture
+    };
+    // Apres le header : Rec[count] tries par (key, cls), puis les coups
+    // (un octet par coup) de toutes les solutions a la suite
+    struct Rec {
+        uint64_t key;
+        uint32_t cls;
+        uint32_t len;
+        uint64_t off;            // depuis le debut des coups
+        int64_t expanded;
+        int64_t generated;
+        double time;
+        char algo[16];
+    };
+
+    std::string path;
+    std::mutex mx;               // plusieurs threads d'un meme process (batch -j)
+    MappedFile file;
+    uint64_t gen = 0;            // generation du fichier projete
+    uint64_t seen = 0;           // MappedFile::identity du fichier au dernier attach
+    const Rec* recs = nullptr;
+    const char* moves = nullptr;
+    std::size_t count = 0;
+
+    void refresh();
+    void attach();
+    bool lock() const;
+    void unlock() const;
+};
+
+#endif // SOLUTIONDB_H
@@ -3,394 +3,2164 @@
 #include <cmath>
 #include <unordered_set>
 #include <chrono>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <unordered_map>
+#include <sstream>
+#include "Mailbox.h"
+#include "ThreadPool.h"
+#include "LayerFiles.h"
+#include "BucketQueue.h"
+#include "MemUsage.h"
 
-Solver::Solver(const Maze& m) {
+namespace {
+
+// HDA* : etat envoye a son proprietaire, le parent reste chez l'expediteur
+struct Msg {
+    Cell player;
+    char move;
+    int cost;
+    int fromW;
+    NodeId fromId;
+};
+
+struct Batch {
+    std::vector<Msg> msgs;
+    std::vector<Cell> boxes; // nbBoxes cases par message
+    Batch* next = nullptr;
+};
+
+const std::size_t BATCH = 64;   // etats par paquet envoye
+const int ROUND = 16;           // noeuds developpes entre deux lectures de la boite
+
+struct Worker {
+    NodeStore st;
+    std::priority_queue<NodeId, std::vector<NodeId>, DeepNodeComparator> open;
+    VisitedSet vu;
+    Mailbox<Batch> inbox;
+    std::vector<std::pair<int, NodeId>> remote; // parent chez un autre thread, par NodeId ({-1, NO_NODE} sinon)
+    std::vector<Batch*> out; // un paquet en cours par destinataire
+    long long nb = 0, gen = 0, dup = 0, dead = 0, peak = 0;
+
+    Worker(int n, const Zobrist* z, const uint8_t* cells, bool assign, int threads)
+        : st(n, z, cells, assign), open(DeepNodeComparator{&st}),
+          vu(&st), out(threads, nullptr) {}
+};
+
+} // namespace
+
+Solver::Solver(const Maze& m) : maze(m) {
+    levelPath = m.getPath();
     h_max = m.getNbLines();
     w_max = m.getNbCols();
-    p_init = m.getPlayerPosition();
+    p_init = toCell(m.getPlayerPosition());
 
-    // init mat
-    dead.assign(h_max, std::vector<bool>(w_max, false));
+    // table plate une fois pour toutes
+    cells.assign(h_max * w_max, 0);
+    nbr.assign(h_max * w_max * 4, NO_CELL);
 
-    for(unsigned int i=0; i<h_max; ++i) {
-        for(unsigned int j=0; j<w_max; ++j) {
+    for(int i=0; i<h_max; ++i) {
+        for(int j=0; j<w_max; ++j) {
+            Cell c = toCell({i, j});
             if(m.isWall({i, j})) {
-                w.push_back({(int)i, (int)j});
+                cells[c] |= C_WALL;
+            } else {
+                cells[c] |= C_FLOOR;
+            }
+            if(m.isGoal({i, j})) {
+                cells[c] |= C_GOAL;
+                g.push_back(c);
             }
             // copie du truc
-            if(m.isDeadlock({(int)i, (int)j})) {
-                dead[i][j] = true;
+            if(m.isDeadlock({i, j})) {
+                cells[c] |= C_DEAD;
+            }
+            for(int d=0; d<4; ++d) {
+                int ni = i + neighbours[d].first;
+                int nj = j + neighbours[d].second;
+                if(ni >= 0 && ni < h_max && nj >= 0 && nj < w_max) {
+                    nbr[c * 4 + d] = toCell({ni, nj});
+                }
             }
         }
     }
-    auto tmp = m.getGoals();
-    g = tmp;
 
-    auto b = m.getBoxes();
-    b_init.insert(b.begin(), b.end());
-}
+    // couloirs de 1 de large (pour les macro-coups)
+    for(int c=0; c<h_max * w_max; ++c) {
+        if(!(cells[c] & C_FLOOR)) continue;
+        if(check_w(step(c, LEFT)) && check_w(step(c, RIGHT))) cells[c] |= C_TUNNEL_V;
+        if(check_w(step(c, TOP)) && check_w(step(c, BOTTOM))) cells[c] |= C_TUNNEL_H;
+    }
+
+    // distances pour les heuristiques
+    heur.init(cells, nbr, g, w_max);
 
-bool Solver::check_w(const std::pair<int, int>& pos) const {
-    for(const auto& x : w) {
-        if(x == pos) return true;
+    for(const auto& b : m.getBoxes()) {
+        b_init.push_back(toCell(b));
     }
-    return false;
+    std::sort(b_init.begin(), b_init.end());
+
+    zob.init(h_max * w_max);
 }
 
-bool Solver::check_g(const std::pair<int, int>& pos) const {
-    for(const auto& x : g) {
-        if(x == pos) return true;
+// Cherche une case d'entree e qui, une fois bouchee, coupe du joueur une
+// zone avec des goals (et sans caisse au depart). On garde celle qui isole
+// le plus de goals, puis on verifie qu'on peut remplir la salle en poussant
+// chaque caisse depuis e, du goal le plus profond au plus proche.
+// Seulement pour les macro-coups, calcule au premier solve qui en a besoin
+void Solver::findGoalRoom() {
+    if(roomDone) return;
+    roomDone = true;
+    int nbCells = h_max * w_max;
+
+    // un seul DFS depuis le joueur (Tarjan) : e est une entree possible si
+    // un de ses fils v a low[v] >= num[e], la zone coupee est alors le
+    // sous-arbre de v, qui occupe order[num[v] .. num[v] + size[v])
+    std::vector<int> num(nbCells, -1), low(nbCells), size(nbCells, 1), nbG(nbCells, 0), nbB(nbCells, 0);
+    std::vector<Cell> order, parent(nbCells, NO_CELL);
+    std::vector<std::pair<Cell, int>> stk; // case, prochaine direction
+    num[p_init] = low[p_init] = 0;
+    order.push_back(p_init);
+    stk.push_back({p_init, 0});
+    int bestGoals = 0, bestSize = 0;
+    Cell bestV = NO_CELL;
+    while(!stk.empty()) {
+        Cell u = stk.back().first;
+        if(stk.back().second < 4) {
+            Cell x = step(u, stk.back().second++);
+            if(check_w(x)) continue;
+            if(num[x] == -1) {
+                parent[x] = u;
+                num[x] = low[x] = order.size();
+                order.push_back(x);
+                stk.push_back({x, 0});
+            } else if(x != parent[u]) {
+                low[u] = std::min(low[u], num[x]);
+            }
+            continue;
+        }
+        // u fini : on remonte ses compteurs dans son pere
+        stk.pop_back();
+        if(check_g(u)) nbG[u]++;
+        if(std::binary_search(b_init.begin(), b_init.end(), u)) nbB[u]++;
+        if(stk.empty()) break;
+        Cell e = stk.back().first;
+        low[e] = std::min(low[e], low[u]);
+        size[e] += size[u];
+        nbG[e] += nbG[u];
+        nbB[e] += nbB[u];
+        if(e == p_init || low[u] < num[e] || nbB[u] || !nbG[u]) continue;
+        // le plus de goals, puis la plus petite salle, puis la plus petite entree
+        if(nbG[u] < bestGoals) continue;
+        if(nbG[u] == bestGoals && (size[u] > bestSize || (size[u] == bestSize && e > roomEntrance))) continue;
+        bestGoals = nbG[u];
+        bestSize = size[u];
+        bestV = u;
+        roomEntrance = e;
     }
-    return false;
+    if(roomEntrance == NO_CELL) return;
+
+    std::vector<char> room(nbCells, 0);
+    for(int i=num[bestV]; i<num[bestV] + size[bestV]; ++i) room[order[i]] = 1;
+
+    // ordre de rangement : du plus loin de l'entree au plus pres
+    std::vector<int> dist(nbCells, -1);
+    std::queue<Cell> q;
+    dist[roomEntrance] = 0;
+    q.push(roomEntrance);
+    while(!q.empty()) {
+        Cell c = q.front();
+        q.pop();
+        for(int d=0; d<4; ++d) {
+            Cell x = step(c, d);
+            if(check_w(x) || !room[x] || dist[x] != -1) continue;
+            dist[x] = dist[c] + 1;
+            q.push(x);
+        }
+    }
+    for(int c=0; c<nbCells; ++c) {
+        if(room[c] && check_g(c)) parking.push_back(c);
+    }
+    std::sort(parking.begin(), parking.end(), [&](Cell a, Cell b) { return dist[a] > dist[b]; });
+
+    // on simule le remplissage : chaque caisse part de l'entree, poussee
+    // depuis une case voisine hors de la salle
+    std::vector<Cell> placed;
+    for(Cell gl : parking) {
+        bool ok = false;
+        for(int d=0; d<4 && !ok; ++d) {
+            Cell out = step(roomEntrance, d);
+            if(check_w(out) || room[out]) continue;
+            ok = boxPath(placed.data(), placed.size(), roomEntrance, out, gl, nullptr) >= 0;
+        }
+        if(!ok) {
+            roomEntrance = NO_CELL;
+            parking.clear();
+            return;
+        }
+        placed.insert(std::upper_bound(placed.begin(), placed.end(), gl), gl);
+    }
+    inRoom = room;
 }
 
-std::vector<Node> Solver::go(const Node& n) const {
-    std::vector<Node> res;
+// Plus petit nombre de poussees pour amener la caisse box en target, les
+// autres caisses bx ne bougent pas. Renvoie -1 si impossible. dirs recoit
+// la direction de chaque poussee
+int Solver::boxPath(const Cell* bx, int n, Cell box, Cell player, Cell target, std::vector<char>* dirs) const {
+    if(box == target) return 0;
+    int nbCells = h_max * w_max;
+    auto blocked = [&](Cell c) { return check_w(c) || std::binary_search(bx, bx + n, c); };
 
-    // up down etc
-    const std::vector<std::pair<int,int>> d = {
-        {-1, 0}, {1, 0}, {0, -1}, {0, 1}
+    // etat = (caisse, joueur normalise), on garde le parent pour refaire les directions
+    struct St { Cell box; Cell player; int parent; char dir; };
+    std::vector<St> states;
+    std::unordered_set<uint32_t> vu;
+    std::vector<char> seen;
+    std::vector<Cell> others(bx, bx + n);
+
+    auto norm = [&](Cell b, Cell p) {
+        std::vector<Cell> o = others;
+        o.insert(std::upper_bound(o.begin(), o.end(), b), b);
+        return normPlayer(o.data(), o.size(), p);
     };
 
-    const char c[] = {0, 1, 2, 3};
+    states.push_back({box, norm(box, player), -1, -1});
+    vu.insert(box * nbCells + states[0].player);
+    for(unsigned int s=0; s<states.size(); ++s) {
+        St cur = states[s];
+        std::vector<Cell> o = others;
+        o.insert(std::upper_bound(o.begin(), o.end(), cur.box), cur.box);
+        reach(o.data(), o.size(), cur.player, seen);
+        for(int d=0; d<4; ++d) {
+            Cell behind = step(cur.box, d ^ 1), to = step(cur.box, d);
+            if(behind == NO_CELL || !seen[behind] || blocked(to) || check_dead(to)) continue;
+            Cell np = norm(to, cur.box);
+            if(!vu.insert(to * nbCells + np).second) continue;
+            states.push_back({to, np, (int)s, (char)d});
+            if(to == target) {
+                std::vector<char> r;
+                for(int k = states.size() - 1; states[k].parent != -1; k = states[k].parent) r.push_back(states[k].dir);
+                if(dirs) dirs->assign(r.rbegin(), r.rend());
+                return r.size();
+            }
+        }
+    }
+    return -1;
+}
+
+// Macro-coup apres la poussee de la caisse from dans la direction dir (arrivee en to).
+// Modifie to et la case du joueur, renvoie le nombre total de poussees
+int Solver::macro(const Cell* bx, int n, Cell from, int dir, Cell& to, Cell& player) const {
+    auto has_box = [&](Cell c) { return std::binary_search(bx, bx + n, c); };
 
+    // salle des goals : la caisse entre par roomEntrance et va au premier goal libre
+    if(to == roomEntrance && !inRoom[from]) {
+        unsigned int j = 0;
+        while(j < parking.size() && has_box(parking[j])) ++j;
+        // les caisses deja dans la salle doivent etre exactement parking[0..j)
+        int inside = 0;
+        for(int k=0; k<n; ++k) if(inRoom[bx[k]]) inside++;
+        if(j < parking.size() && inside == (int)j) {
+            std::vector<Cell> others;
+            for(int k=0; k<n; ++k) if(bx[k] != from) others.push_back(bx[k]);
+            std::vector<char> dirs;
+            int nb = boxPath(others.data(), others.size(), to, from, parking[j], &dirs);
+            if(nb > 0) {
+                to = parking[j];
+                player = step(to, dirs.back() ^ 1);
+                return 1 + nb;
+            }
+        }
+    }
+
+    // tunnel : on continue tant que la caisse est dans un couloir
+    int pushes = 1;
+    uint8_t axis = dir < 2 ? C_TUNNEL_V : C_TUNNEL_H;
+    while(!check_g(to) && (cells[to] & axis)) {
+        Cell nx = step(to, dir);
+        if(check_w(nx) || has_box(nx) || check_dead(nx)) break;
+        to = nx;
+        pushes++;
+    }
+    player = step(to, dir ^ 1);
+    return pushes;
+}
+
+// La base de motifs n'est calculee (ou relue) qu'au premier solve
+void Solver::loadPatterns() {
+    if(!patterns || ddb.ready() || levelPath.empty()) return;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    // Echap et le budget arretent aussi le calcul des motifs
+    ddb.init(levelPath + ".dl", cells, nbr, p_init, 3, [this]() { return cancelled(); });
+    auto t2 = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> diff = t2 - t1;
+    if(!verbose || !ddb.ready()) return;
+    std::cout << "Motifs morts : " << ddb.nbPatterns()
+              << (ddb.fromCache() ? " (cache)" : "")
+              << " t: " << diff.count() << "s" << std::endl;
+}
+
+static double since(std::chrono::high_resolution_clock::time_point t) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t).count();
+}
+
+Solver::~Solver() {
+    stopWatch();
+}
+
+void Solver::begin() {
+    stopWatch();
+    hit = NO_HIT;
+    ss = SearchStats();
+    tPhase = Clock::now();
+    if(budget.seconds > 0 || budget.memMB) startWatch();
+    if(macros && pushMode) findGoalRoom();
+}
+
+void Solver::startWatch() {
+    watchStop = false;
+    Clock::time_point t0 = tPhase;
+    watch = std::thread([this, t0]() {
+        while(!watchStop) {
+            if(budget.seconds > 0 && since(t0) > budget.seconds) overBudget(HIT_TIME);
+            if(budget.memMB && MemUsage::current() > budget.memMB * 1024 * 1024) overBudget(HIT_MEMORY);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+}
+
+void Solver::stopWatch() {
+    if(!watch.joinable()) return;
+    watchStop = true;
+    watch.join();
+}
+
+std::future<std::vector<char>> Solver::solveAsync(const Maze& m, std::function<std::vector<char>(Solver&)> f,
+                                                  const std::atomic<bool>* stop) {
+    return std::async(std::launch::async, [m, f, stop]() {
+        Solver s(m);
+        s.setCancel(stop);
+        return f(s);
+    });
+}
+
+void Solver::searching() {
+    ss.tInit = since(tPhase);
+    tPhase = Clock::now();
+}
+
+void Solver::endSearch(long long closed) {
+    stopWatch();
+    ss.closed = closed;
+    ss.tSearch = since(tPhase);
+    tPhase = Clock::now();
+}
+
+void Solver::snapshot() {
+    ss.tSearch = since(tPhase);
+    progress(ss);
+}
+
+std::vector<char> Solver::report(const char* name, const std::vector<char>& r, const std::string& extra) {
+    if(!r.empty()) ss.tPath = since(tPhase);
+    if(!verbose) return r;
+    std::cout << name << (r.empty() ? " rate..." : " trouve !");
+    if(!r.empty()) std::cout << " len: " << r.size();
+    std::cout << " noeuds: " << ss.expanded
+              << " generes: " << ss.generated
+              << " vus: " << ss.closed;
+    if(corralPrune) std::cout << " corral: " << nbCorral;
+    const char* why[] = {"", " (temps)", " (noeuds)", " (memoire)", " (profondeur)"};
+    if(hit) std::cout << " budget depasse" << why[hit];
+    std::cout << extra << " t: " << ss.total() << "s" << std::endl;
+    return r;
+}
+
+void Solver::go(const NodeStore& st, NodeId id, std::vector<Succ>& res) const {
+    go(st.boxes(id), st.nbBoxes(), st.at(id).playerPos, res);
+}
+
+void Solver::go(const Cell* bx, int n, Cell player, std::vector<Succ>& res) const {
+    res.clear();
+
+    const Cell* bx_end = bx + n;
+    // les caisses sont triees donc recherche dicho
+    auto has_box = [&](Cell c) { return std::binary_search(bx, bx_end, c); };
+
+    // up down etc
     for(int i=0; i<4; ++i) {
-        std::pair<int, int> np = {
-            n.playerPos.first + d[i].first,
-            n.playerPos.second + d[i].second
-        };
+        Cell np = step(player, i);
 
         if(check_w(np)) continue;
 
-        bool push = false;
-        if(n.boxes.count(np)) {
-            std::pair<int, int> nbp = {
-                np.first + d[i].first,
-                np.second + d[i].second
-            };
+        if(has_box(np)) {
+            Cell nbp = step(np, i);
 
             if(check_w(nbp)) continue;
-            if(n.boxes.count(nbp)) continue; // deja une caisse
-            if(dead[nbp.first][nbp.second]) continue; // coin
-
-            push = true;
+            if(has_box(nbp)) continue; // deja une caisse
+            if(check_dead(nbp)) continue; // coin
 
-            Node nx = n;
-            nx.playerPos = np;
-            nx.boxes.erase(np);
-            nx.boxes.insert(nbp);
-            nx.path.push_back(c[i]);
-            nx.cost = n.cost + 1;
-
-            res.push_back(nx);
+            Succ sx;
+            sx.player = np;
+            sx.move = i;
+            sx.from = np;
+            sx.to = nbp;
+            res.push_back(sx);
 
         } else {
             // bouge simple
-            Node nx = n;
-            nx.playerPos = np;
-            nx.path.push_back(c[i]);
-            nx.cost = n.cost + 1;
-            res.push_back(nx);
+            Succ sx;
+            sx.player = np;
+            sx.move = i;
+            res.push_back(sx);
         }
     }
+}
 
-    return res;
+bool Solver::isWin(const NodeStore& st, NodeId id) const {
+    return st.at(id).goals == st.nbBoxes();
+}
+
+// zone accessible au joueur (seen[c] = 1) sans pousser de caisse
+void Solver::reach(const Cell* bx, int n, Cell p, std::vector<char>& seen) const {
+    seen.assign(h_max * w_max, 0);
+    thread_local std::vector<Cell> todo;
+    todo.clear();
+    todo.push_back(p);
+    seen[p] = 1;
+    while(!todo.empty()) {
+        Cell cur = todo.back();
+        todo.pop_back();
+        for(int d=0; d<4; ++d) {
+            Cell c = step(cur, d);
+            if(check_w(c) || seen[c]) continue;
+            if(std::binary_search(bx, bx + n, c)) continue;
+            seen[c] = 1;
+            todo.push_back(c);
+        }
+    }
+}
+
+Cell Solver::normPlayer(const Cell* bx, int n, Cell p) const {
+    thread_local std::vector<char> seen; // pas de malloc a chaque appel
+    reach(bx, n, p, seen);
+    for(unsigned int c=0; c<seen.size(); ++c) {
+        if(seen[c]) return c;
+    }
+    return p;
+}
+
+// normPlayer apres une seule poussee de la caisse b vers t, sans refaire le
+// remplissage : seen est la zone du parent, m1 < m2 ses 2 plus petites
+// cases. Le joueur arrive sur b, il garde la zone moins t (si t ne la coupe
+// pas en deux) et gagne ce qui s'ouvre derriere b. bx = caisses du parent.
+// NO_CELL si t coupe peut-etre la zone : il faut tout refaire
+Cell Solver::normAfterPush(const Cell* bx, int n, const std::vector<char>& seen, Cell m1, Cell m2, Cell b, Cell t) const {
+    auto in = [&](Cell c) { return c != NO_CELL && seen[c]; };
+    if(seen[t]) {
+        // le tour de t (8 cases, 2 voisines se touchent) : les voisins de t
+        // dans la zone doivent rester relies par ce tour
+        Cell r[8];
+        r[0] = step(t, TOP);    r[1] = step(r[0], RIGHT);
+        r[2] = step(t, RIGHT);  r[3] = step(r[2], BOTTOM);
+        r[4] = step(t, BOTTOM); r[5] = step(r[4], LEFT);
+        r[6] = step(t, LEFT);   r[7] = step(r[6], TOP);
+        int nb = 0, links = 0;
+        for(int i=0; i<8; i+=2) {
+            if(!in(r[i])) continue;
+            nb++;
+            if(in(r[(i + 6) % 8]) && in(r[(i + 7) % 8])) links++; // relie au voisin d'avant
+        }
+        if(nb - links + (links == 4) > 1) return NO_CELL;
+    }
+
+    Cell best = std::min(b, t == m1 ? m2 : m1);
+    // ce qui s'ouvre derriere b (en general rien : ses voisins sont des
+    // murs, des caisses ou deja dans la zone)
+    thread_local std::vector<uint32_t> mark;
+    thread_local uint32_t stamp = 0;
+    thread_local std::vector<Cell> todo;
+    if(mark.size() != seen.size() || ++stamp == 0) { mark.assign(seen.size(), 0); stamp = 1; }
+    todo.clear();
+    todo.push_back(b);
+    mark[b] = stamp;
+    while(!todo.empty()) {
+        Cell cur = todo.back();
+        todo.pop_back();
+        for(int d=0; d<4; ++d) {
+            Cell c = step(cur, d);
+            if(check_w(c) || c == t || seen[c] || mark[c] == stamp) continue;
+            if(std::binary_search(bx, bx + n, c)) continue;
+            mark[c] = stamp;
+            best = std::min(best, c);
+            todo.push_back(c);
+        }
+    }
+    return best;
+}
+
+// Cherche un PI-corral : une zone libre que le joueur n'atteint pas, dont
+// toutes les poussees possibles des caisses du bord vont vers l'interieur (I)
+// et sont faisables depuis la zone du joueur (P). Si il y en a un, une
+// solution commence forcement par pousser une de ses caisses, donc keep[k]
+// dit quelles caisses garder (on prend le corral avec le moins de caisses)
+bool Solver::piCorral(const Cell* bx, int n, const std::vector<char>& seen, std::vector<char>& keep) const {
+    auto has_box = [&](Cell c) { return std::binary_search(bx, bx + n, c); };
+
+    // 1. numerote les zones libres pas atteignables
+    std::vector<int> reg(h_max * w_max, -1);
+    int nbReg = 0;
+    std::vector<Cell> todo;
+    for(int c=0; c<h_max * w_max; ++c) {
+        if(seen[c] || reg[c] != -1 || !(cells[c] & C_FLOOR) || has_box(c)) continue;
+        reg[c] = nbReg;
+        todo.push_back(c);
+        while(!todo.empty()) {
+            Cell cur = todo.back();
+            todo.pop_back();
+            for(int d=0; d<4; ++d) {
+                Cell x = step(cur, d);
+                if(check_w(x) || reg[x] != -1 || has_box(x)) continue;
+                reg[x] = nbReg;
+                todo.push_back(x);
+            }
+        }
+        nbReg++;
+    }
+    if(nbReg == 0) return false;
+
+    // 2. teste chaque zone
+    int best = -1;
+    std::vector<char> mask(n);
+    for(int r=0; r<nbReg; ++r) {
+        std::fill(mask.begin(), mask.end(), 0);
+        bool work = false; // faut-il encore toucher a ce corral ?
+        for(int c=0; c<h_max * w_max; ++c) {
+            if(reg[c] != r) continue;
+            if(check_g(c)) work = true;
+            for(int d=0; d<4; ++d) {
+                Cell b = step(c, d);
+                if(b == NO_CELL || !has_box(b)) continue;
+                int k = std::lower_bound(bx, bx + n, b) - bx;
+                mask[k] = 1;
+                if(!check_g(b)) work = true;
+            }
+        }
+        if(!work) continue;
+
+        bool pi = true;
+        int nbB = 0;
+        for(int k=0; k<n && pi; ++k) {
+            if(!mask[k]) continue;
+            nbB++;
+            for(int d=0; d<4; ++d) {
+                Cell t = step(bx[k], d), p = step(bx[k], d ^ 1);
+                if(check_w(t) || has_box(t) || check_w(p)) continue; // jamais possible
+                if(reg[t] == r) {
+                    if(!seen[p]) { pi = false; break; } // P : le joueur doit pouvoir le faire
+                } else if(seen[p] && !check_dead(t)) {
+                    pi = false; break; // I : poussee vers l'exterieur possible
+                }
+            }
+        }
+        if(!pi) continue;
+        if(best == -1 || nbB < std::count(keep.begin(), keep.end(), 1)) {
+            best = r;
+            keep = mask;
+        }
+    }
+    return best != -1;
+}
+
+// que des poussees : pour chaque caisse et chaque direction, le joueur
+// doit pouvoir aller derriere la caisse et la case d'arrivee doit etre libre
+void Solver::goPush(const NodeStore& st, NodeId id, std::vector<Succ>& res) const {
+    goPush(st.boxes(id), st.nbBoxes(), st.at(id).playerPos, res);
+}
+
+void Solver::goPush(const Cell* bx, int n, Cell player, std::vector<Succ>& res) const {
+    res.clear();
+
+    thread_local std::vector<char> seen;
+    reach(bx, n, player, seen);
+    // les 2 plus petites cases de la zone, pour normAfterPush
+    Cell m1 = NO_CELL, m2 = NO_CELL;
+    for(unsigned int c=0; c<seen.size() && m2 == NO_CELL; ++c) {
+        if(!seen[c]) continue;
+        if(m1 == NO_CELL) m1 = c;
+        else m2 = c;
+    }
+
+    // PI-corral : on ne garde que les caisses du corral
+    std::vector<char> keep;
+    bool corral = corralPrune && piCorral(bx, n, seen, keep);
+
+    std::vector<Cell> tmp(bx, bx + n);
+    for(int k=0; k<n; ++k) {
+        for(int i=0; i<4; ++i) {
+            Cell from = step(bx[k], i ^ 1); // direction opposee
+            Cell to = step(bx[k], i);
+            if(from == NO_CELL || !seen[from]) continue; // joueur peut pas y aller
+            if(check_w(to) || std::binary_search(bx, bx + n, to)) continue;
+            if(check_dead(to)) continue;
+            if(corral && !keep[k]) {
+                nbCorral++;
+                continue;
+            }
+
+            Succ sx;
+            Cell np = bx[k];
+            if(macros) sx.pushes = macro(bx, n, bx[k], i, to, np);
+
+            // position normalisee apres la poussee (le joueur est sur
+            // l'ancienne case). Pour une poussee simple on part de la zone
+            // deja calculee, sinon (macro, zone coupee) on refait tout
+            sx.player = sx.pushes == 1 ? normAfterPush(bx, n, seen, m1, m2, bx[k], to) : NO_CELL;
+            if(sx.player == NO_CELL) {
+                tmp.assign(bx, bx + n);
+                NodeStore::moveBox(tmp.data(), n, bx[k], to);
+                sx.player = normPlayer(tmp.data(), n, np);
+            }
+            sx.move = i;
+            sx.from = bx[k];
+            sx.to = to;
+            res.push_back(sx);
+        }
+    }
+}
+
+void Solver::expand(const NodeStore& st, NodeId id, std::vector<Succ>& res) const {
+    if(pushMode) goPush(st, id, res);
+    else go(st, id, res);
+}
+
+// plus court chemin du joueur de from a to sans toucher aux caisses
+bool Solver::walk(const Cell* bx, int n, Cell from, Cell to, std::vector<char>& moves) const {
+    std::vector<char> dir(h_max * w_max, -1); // direction d'arrivee sur la case
+    std::queue<Cell> q;
+    q.push(from);
+    dir[from] = 4;
+    while(!q.empty() && dir[to] == -1) {
+        Cell cur = q.front();
+        q.pop();
+        for(int d=0; d<4; ++d) {
+            Cell c = step(cur, d);
+            if(check_w(c) || dir[c] != -1) continue;
+            if(std::binary_search(bx, bx + n, c)) continue;
+            dir[c] = d;
+            q.push(c);
+        }
+    }
+    if(dir[to] == -1) return false;
+
+    std::vector<char> r;
+    for(Cell c = to; c != from; c = step(c, dir[c] ^ 1)) {
+        r.push_back(dir[c]);
+    }
+    moves.insert(moves.end(), r.rbegin(), r.rend());
+    return true;
+}
+
+// En mode poussees on refait les deplacements entre les poussees a la fin
+// Vide si un bout du chemin ne se rejoue pas (ne devrait jamais arriver)
+std::vector<char> Solver::pushPath(const NodeStore& st, NodeId id) const {
+    std::vector<NodeId> chain;
+    for(NodeId cur = id; cur != NO_NODE; cur = st.at(cur).parent) chain.push_back(cur);
+    std::reverse(chain.begin(), chain.end());
+
+    std::vector<char> r;
+    Cell pos = p_init;
+    int n = st.nbBoxes();
+    for(unsigned int k=1; k<chain.size(); ++k) {
+        const Cell* pb = st.boxes(chain[k-1]);
+        const Cell* cb = st.boxes(chain[k]);
+        // la caisse poussee = celle qui est chez le parent et plus chez le fils
+        Cell from = NO_CELL;
+        for(int i=0; i<n; ++i) {
+            if(!std::binary_search(cb, cb + n, pb[i])) { from = pb[i]; break; }
+        }
+        char dir = st.at(chain[k]).move;
+        Cell to = NO_CELL;
+        for(int i=0; i<n; ++i) {
+            if(!std::binary_search(pb, pb + n, cb[i])) { to = cb[i]; break; }
+        }
+        if(to == step(from, dir)) {
+            if(!walk(pb, n, pos, step(from, dir ^ 1), r)) return {};
+            r.push_back(dir);
+            pos = from;
+            continue;
+        }
+
+        // macro-coup : on retrouve les poussees et on marche entre chacune
+        std::vector<Cell> others;
+        for(int i=0; i<n; ++i) if(pb[i] != from) others.push_back(pb[i]);
+        std::vector<char> dirs;
+        if(boxPath(others.data(), others.size(), from, pos, to, &dirs) < 0) return {};
+        std::vector<Cell> cur(pb, pb + n);
+        Cell box = from;
+        for(char d : dirs) {
+            if(!walk(cur.data(), n, pos, step(box, d ^ 1), r)) return {};
+            r.push_back(d);
+            pos = box;
+            Cell nx = step(box, d);
+            NodeStore::moveBox(cur.data(), n, box, nx);
+            box = nx;
+        }
+        if(box != to) return {};
+    }
+    return r;
+}
+
+std::vector<char> Solver::solution(const NodeStore& st, NodeId id) const {
+    return pushMode ? pushPath(st, id) : st.path(id);
 }
 
 std::vector<char> Solver::solveBFS() {
-    auto t1 = std::chrono::high_resolution_clock::now();
-    std::queue<Node> q;
-    std::unordered_set<Node, NodeHash> vu;
+    begin();
+    loadPatterns();
+    NodeStore st(b_init.size(), &zob, cells.data());
+    std::queue<NodeId> q;
+    VisitedSet vu(&st);
 
-    Node s;
-    s.playerPos = p_init;
-    s.boxes = b_init;
+    NodeId s = st.root(pushMode ? normPlayer(b_init.data(), b_init.size(), p_init) : p_init, b_init);
 
     q.push(s);
     vu.insert(s);
+    searching();
 
-    int nb = 0;
+    std::vector<Succ> next;
 
-    while(!q.empty()) {
-        Node curr = q.front();
+    while(!q.empty() && !cancelled()) {
+        NodeId curr = q.front();
         q.pop();
-        nb++;
+        tick();
 
         // win ?
-        bool ok = true;
-        for(const auto& b : curr.boxes) {
-            if(!check_g(b)) {
-                ok = false;
-                break;
+        if(isWin(st, curr)) {
+            endSearch(vu.size());
+            return report("BFS", solution(st, curr));
+        }
+
+        expand(st, curr, next);
+        ss.generated += next.size();
+        for(const auto& x : next) {
+            NodeId id = st.push(curr, x);
+            if(test_dl(st, id, x.to)) {
+                st.pop();
+                ss.deadlocks++;
+                continue; // gele
+            }
+            if(vu.insert(id).second) {
+                q.push(id);
+            } else {
+                st.pop(); // deja vu
+                ss.duplicates++;
             }
         }
-        if(ok) {
-            auto t2 = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> diff = t2 - t1;
-            std::cout << "BFS trouve : " << curr.path.size()
-                      << " noeuds: " << nb
-                      << " temps: " << diff.count() << "s" << std::endl;
-            std::vector<char> r(curr.path.begin(), curr.path.end());
-            return r;
+        ss.openPeak = std::max<long long>(ss.openPeak, q.size());
+    }
+
+    endSearch(vu.size());
+    return report("BFS", {});
+}
+
+// Chaque couche se fait en 3 temps :
+// 1. les threads developpent chacun un morceau de la couche dans leur propre
+//    buffer (avec un petit store a eux pour tester les deadlocks)
+// 2. dedoublonnage : le vu est coupe en une part par thread selon le hash,
+//    chaque thread ne touche que sa part donc pas de verrou. On garde la
+//    premiere occurrence dans l'ordre de la couche, comme le BFS normal
+// 3. on ajoute les nouveaux etats au store, dans l'ordre (seul bout en serie)
+std::vector<char> Solver::solveBFSParallel(int threads) {
+    begin();
+    loadPatterns();
+    ThreadPool pool(threads);
+    int T = pool.size();
+    int n = b_init.size();
+
+    struct Cand {
+        NodeId parent;
+        Succ x;
+        uint64_t hash;
+    };
+    struct Buf {
+        std::vector<Cand> cands;
+        std::vector<Cell> boxes; // n cases par candidat
+        std::vector<char> keep;
+        long long gen = 0, dead = 0;
+    };
+
+    NodeStore st(n, &zob, cells.data());
+    std::vector<NodeStore> scratch(T, NodeStore(n, &zob, cells.data()));
+    std::vector<Buf> buf(T);
+    std::vector<VisitedSet> vu;
+    for(int t=0; t<T; ++t) vu.emplace_back(&st);
+    auto owner = [&](uint64_t h) { return (int)((h >> 40) % T); };
+
+    NodeId s = st.root(pushMode ? normPlayer(b_init.data(), n, p_init) : p_init, b_init);
+    vu[owner(st.at(s).hash)].add(s);
+    std::vector<NodeId> layer(1, s), nextLayer;
+    std::string extra = " threads: " + std::to_string(T);
+    searching();
+
+    while(!layer.empty() && !cancelled()) {
+        // win ? (le premier de la couche, comme la file du BFS normal)
+        for(NodeId id : layer) {
+            if(!isWin(st, id)) continue;
+            endSearch(st.size());
+            return report("BFS //", solution(st, id), extra);
         }
+        ss.openPeak = std::max<long long>(ss.openPeak, layer.size());
+        tick(layer.size());
 
-        std::vector<Node> next = go(curr);
-        for(const auto& x : next) {
-            if(vu.find(x) == vu.end()) {
-                vu.insert(x);
-                q.push(x);
+        // 1. developpement
+        pool.run([&](int t) {
+            Buf& b = buf[t];
+            NodeStore& sc = scratch[t];
+            b.cands.clear();
+            b.boxes.clear();
+            std::vector<Succ> next;
+            std::size_t lo = layer.size() * t / T, hi = layer.size() * (t + 1) / T;
+            for(std::size_t i=lo; i<hi && !cancelled(); ++i) {
+                NodeId p = layer[i];
+                NodeId r = sc.root(st.at(p).playerPos, std::vector<Cell>(st.boxes(p), st.boxes(p) + n));
+                expand(st, p, next);
+                b.gen += next.size();
+                for(const auto& x : next) {
+                    NodeId id = sc.push(r, x);
+                    if(!test_dl(sc, id, x.to)) {
+                        b.cands.push_back({p, x, sc.at(id).hash});
+                        b.boxes.insert(b.boxes.end(), sc.boxes(id), sc.boxes(id) + n);
+                    } else {
+                        b.dead++;
+                    }
+                    sc.pop();
+                }
+                sc.pop();
+            }
+            b.keep.assign(b.cands.size(), 0);
+        });
+        for(auto& b : buf) {
+            ss.generated += b.gen;
+            ss.deadlocks += b.dead;
+            b.gen = b.dead = 0;
+        }
+
+        // 2. dedoublonnage, chaque thread sa part du vu
+        pool.run([&](int t) {
+            std::unordered_multimap<uint64_t, std::pair<int, std::size_t>> layerSeen;
+            auto same = [&](const Cand& c, const Cell* bx, Cell player, const Cell* other) {
+                return c.x.player == player && std::memcmp(bx, other, n * sizeof(Cell)) == 0;
+            };
+            for(int k=0; k<T; ++k) {
+                const Buf& b = buf[k];
+                for(std::size_t i=0; i<b.cands.size(); ++i) {
+                    const Cand& c = b.cands[i];
+                    if(owner(c.hash) != t) continue;
+                    const Cell* bx = b.boxes.data() + i * n;
+                    bool dup = vu[t].find(c.hash, [&](NodeId o) { return same(c, bx, st.at(o).playerPos, st.boxes(o)); })
+                               != vu[t].end();
+                    auto cur = layerSeen.equal_range(c.hash);
+                    for(auto it = cur.first; it != cur.second && !dup; ++it) {
+                        const Buf& ob = buf[it->second.first];
+                        std::size_t j = it->second.second;
+                        dup = same(c, bx, ob.cands[j].x.player, ob.boxes.data() + j * n);
+                    }
+                    if(dup) continue;
+                    layerSeen.insert({c.hash, {k, i}});
+                    buf[k].keep[i] = 1;
+                }
+            }
+        });
+
+        // 3. ajout dans l'ordre de la couche
+        nextLayer.clear();
+        for(int k=0; k<T; ++k) {
+            const Buf& b = buf[k];
+            for(std::size_t i=0; i<b.cands.size(); ++i) {
+                if(!b.keep[i]) {
+                    ss.duplicates++;
+                    continue;
+                }
+                NodeId id = st.push(b.cands[i].parent, b.cands[i].x);
+                vu[owner(b.cands[i].hash)].add(id);
+                nextLayer.push_back(id);
             }
         }
+        layer.swap(nextLayer);
     }
 
-    auto t2 = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> diff = t2 - t1;
-    std::cout << "BFS rate... " << diff.count() << "s" << std::endl;
-    return {};
+    endSearch(st.size());
+    return report("BFS //", {}, extra);
+}
+
+// Couche d+1 = fils de la couche d, lus un par un dans son fichier. Le
+// seul etat du BFS en RAM c'est le tampon de LayerFiles, le store ne sert
+// qu'a developper un etat a la fois (et a tester les deadlocks)
+std::vector<char> Solver::solveBFSExternal() {
+    begin();
+    loadPatterns();
+    int n = b_init.size();
+    int w = n + 1; // joueur + caisses
+    LayerFiles lf(extDir, w, (std::size_t)std::max(1, extMB) * 1024 * 1024);
+    NodeStore sc(n, &zob, cells.data());
+    std::vector<Succ> next;
+    std::vector<Cell> rec(w);
+
+    // un etat du store -> son enregistrement dans les fichiers
+    auto toRec = [&](NodeId id) {
+        rec[0] = sc.at(id).playerPos;
+        std::copy(sc.boxes(id), sc.boxes(id) + n, rec.begin() + 1);
+    };
+    auto load = [&](const Cell* s) { return sc.root(s[0], std::vector<Cell>(s + 1, s + w)); };
+
+    Cell p0 = pushMode ? normPlayer(b_init.data(), n, p_init) : p_init;
+    NodeId r0 = sc.root(p0, b_init);
+    toRec(r0);
+    int found = isWin(sc, r0) ? 0 : -1;
+    sc.pop();
+    lf.add(rec.data());
+    long long total = lf.commit(0);
+    searching();
+
+    // couche found : le gagnant, son pere (couche found - 1) et le coup
+    std::vector<Cell> target;
+    Succ last;
+    int layers = 1;
+    for(int d = 0; found < 0 && total > 0 && lf.ok() && !cancelled(); ++d) {
+        LayerFiles::Reader in(lf.layer(d), w);
+        long long size = 0;
+        for(const Cell* s = in.next(); s && found < 0 && !cancelled(); s = in.next()) {
+            tick();
+            size++;
+            NodeId cur = load(s);
+            expand(sc, cur, next);
+            ss.generated += next.size();
+            for(const auto& x : next) {
+                NodeId id = sc.push(cur, x);
+                if(test_dl(sc, id, x.to)) {
+                    ss.deadlocks++;
+                } else if(isWin(sc, id)) {
+                    found = d + 1;
+                    target.assign(s, s + w);
+                    last = x;
+                } else {
+                    toRec(id);
+                    lf.add(rec.data());
+                }
+                sc.pop();
+                if(found >= 0) break;
+            }
+            sc.pop();
+        }
+        ss.openPeak = std::max(ss.openPeak, size);
+        if(found >= 0 || cancelled()) break;
+        long long k = lf.commit(d + 1);
+        ss.duplicates = lf.dropped();
+        if(k <= 0) break;
+        total += k;
+        layers++;
+    }
+    ss.duplicates = lf.dropped();
+    endSearch(total);
+
+    std::string extra = " couches: " + std::to_string(layers)
+                      + " disque: " + std::to_string(lf.bytes() / (1024 * 1024)) + "Mo";
+    if(!lf.ok()) extra += " (erreur d'ecriture)";
+    if(found < 0) return report("BFS disque", {}, extra);
+
+    // retour en arriere : dans la couche k on cherche un etat qui a target
+    // comme fils, il devient la nouvelle target
+    std::vector<Succ> steps(found);
+    if(found > 0) steps[found - 1] = last;
+    for(int k = found - 2; k >= 0 && !cancelled(); --k) {
+        LayerFiles::Reader in(lf.layer(k), w);
+        bool hit = false;
+        for(const Cell* s = in.next(); s && !hit; s = in.next()) {
+            NodeId cur = load(s);
+            expand(sc, cur, next);
+            for(const auto& x : next) {
+                NodeId id = sc.push(cur, x);
+                toRec(id);
+                sc.pop();
+                if(rec != target) continue;
+                steps[k] = x;
+                target.assign(s, s + w);
+                hit = true;
+                break;
+            }
+            sc.pop();
+        }
+        if(!hit) return report("BFS disque", {}, extra);
+    }
+    if(cancelled()) return report("BFS disque", {}, extra);
+
+    // on rejoue les coups dans un vrai store pour refaire la solution
+    NodeStore st(n, &zob, cells.data());
+    NodeId cur = st.root(p0, b_init);
+    for(const auto& x : steps) cur = st.push(cur, x);
+    return report("BFS disque", solution(st, cur), extra);
 }
 
 std::vector<char> Solver::solveDFS() {
-    auto t1 = std::chrono::high_resolution_clock::now();
-    std::stack<Node> pile;
-    std::unordered_set<Node, NodeHash> vu;
+    begin();
+    loadPatterns();
+    NodeStore st(b_init.size(), &zob, cells.data());
+    std::stack<NodeId> pile;
+    VisitedSet vu(&st);
 
-    Node s;
-    s.playerPos = p_init;
-    s.boxes = b_init;
+    NodeId s = st.root(pushMode ? normPlayer(b_init.data(), b_init.size(), p_init) : p_init, b_init);
 
     pile.push(s);
     vu.insert(s);
+    searching();
 
-    int nb = 0;
+    std::vector<Succ> next;
 
-    while(!pile.empty()) {
-        Node curr = pile.top();
+    while(!pile.empty() && !cancelled()) {
+        NodeId curr = pile.top();
         pile.pop();
-        nb++;
+        tick();
 
          // win ?
-        bool ok = true;
-        for(const auto& b : curr.boxes) {
-            if(!check_g(b)) {
-                ok = false;
-                break;
-            }
-        }
-        if(ok) {
-            auto t2 = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> diff = t2 - t1;
-            std::cout << "DFS trouve : " << curr.path.size()
-                      << " noeuds: " << nb
-                      << " temps: " << diff.count() << "s" << std::endl;
-            std::vector<char> r(curr.path.begin(), curr.path.end());
-            return r;
+        if(isWin(st, curr)) {
+            endSearch(vu.size());
+            return report("DFS", solution(st, curr));
         }
 
-        std::vector<Node> next = go(curr);
+        expand(st, curr, next);
+        ss.generated += next.size();
 
         for(const auto& x : next) {
-            if(vu.find(x) == vu.end()) {
-                vu.insert(x);
-                pile.push(x);
+            NodeId id = st.push(curr, x);
+            if(test_dl(st, id, x.to)) {
+                st.pop();
+                ss.deadlocks++;
+                continue; // gele
+            }
+            if(vu.insert(id).second) {
+                pile.push(id);
+            } else {
+                st.pop();
+                ss.duplicates++;
             }
         }
+        ss.openPeak = std::max<long long>(ss.openPeak, pile.size());
     }
-    auto t2 = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> diff = t2 - t1;
-    std::cout << "DFS rate... " << diff.count() << "s" << std::endl;
-    return {};
+    endSearch(vu.size());
+    return report("DFS", {});
+}
+
+int Solver::calc_h(NodeStore& st, NodeId id) const {
+    return heur.eval(hType, st.boxes(id), st.nbBoxes(), st.assign(id));
 }
 
-int Solver::calc_h(const Node& n) const {
-    int val = 0;
-    for(const auto& b : n.boxes) {
-        int min_d = 999999;
-        for(const auto& gl : g) {
-            int d = std::abs(b.first - gl.first) + std::abs(b.second - gl.second);
-            if(d < min_d) min_d = d;
+// h du fils a partir du pere : une poussee ne bouge qu'une caisse
+void Solver::child_h(NodeStore& st, NodeId id, const Succ& x) const {
+    Node& n = st.at(id);
+    int hp = st.at(n.parent).heuristic;
+    Cell from = x.from, to = x.to;
+    n.heuristic = hp;
+    if(from == NO_CELL) return; // simple pas, rien ne change
+
+    if(hType == Heuristic::MANHATTAN) {
+        n.heuristic += heur.manhattan(to) - heur.manhattan(from);
+        return;
+    }
+
+    // la caisse garde le goal qu'elle avait chez le pere
+    const Cell* bx = st.boxes(id);
+    int i = std::lower_bound(bx, bx + st.nbBoxes(), to) - bx;
+    int k = st.assign(id)[i];
+    int d_old = heur.pushDist(k, from);
+    int d_new = heur.pushDist(k, to);
+    if(d_new != Heuristic::INF) {
+        // une poussee fait baisser l'affectation optimale d'au plus 1,
+        // donc si on a gagne 1 par poussee c'est encore l'optimum
+        if(hType == Heuristic::GREEDY_MATCH || d_old - d_new == x.pushes) {
+            n.heuristic = hp - d_old + d_new;
+            return;
         }
-        val += min_d;
     }
-    return val;
+    // sinon on garde le minorant et on recalcule a la sortie de la file
+    n.heuristic = std::max(0, hp - x.pushes);
+    n.stale = true;
+}
+
+// Recalcule h si c'etait un minorant. Renvoie true si le noeud doit
+// retourner dans la file (h a augmente ou mort)
+bool Solver::refresh_h(NodeStore& st, NodeId id) const {
+    Node& n = st.at(id);
+    if(!n.stale) return false;
+    int old = n.heuristic;
+    n.heuristic = calc_h(st, id);
+    n.stale = false;
+    return n.heuristic != old;
 }
 
 std::vector<char> Solver::solveAStar() {
-    auto t1 = std::chrono::high_resolution_clock::now();
-    std::priority_queue<Node, std::vector<Node>, NodeComparator> q;
-    std::unordered_set<Node, NodeHash> vu;
+    begin();
+    loadPatterns();
+    NodeStore st(b_init.size(), &zob, cells.data(), Heuristic::needsAssign(hType));
+    BucketQueue q(lifo); // f puis h
+    VisitedSet vu(&st);
 
-    Node s;
-    s.playerPos = p_init;
-    s.boxes = b_init;
-    s.heuristic = calc_h(s); // h
+    NodeId s = st.root(pushMode ? normPlayer(b_init.data(), b_init.size(), p_init) : p_init, b_init);
+    st.at(s).heuristic = calc_h(st, s); // h
 
-    q.push(s);
+    q.push(s, st.at(s).f(), st.at(s).heuristic);
     vu.insert(s);
+    searching();
 
-    int nb = 0;
+    std::vector<Succ> next;
 
-    while(!q.empty()) {
-        Node curr = q.top();
-        q.pop();
-        nb++;
+    while(!q.empty() && !cancelled()) {
+        NodeId curr = q.pop();
+        if(*vu.find(curr) != curr) continue; // remplace par un chemin plus court
 
-        // win ?
-        bool ok = true;
-        for(const auto& b : curr.boxes) {
-            if(!check_g(b)) {
-                ok = false;
-                break;
-            }
+        // h exact avant d'etendre, on le remet dans la file si il a change
+        if(refresh_h(st, curr)) {
+            if(st.at(curr).heuristic < Heuristic::INF) q.push(curr, st.at(curr).f(), st.at(curr).heuristic);
+            continue;
         }
-        if(ok) {
-            auto t2 = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> diff = t2 - t1;
-            std::cout << "A* trouve ! len: " << curr.path.size()
-                      << " noeuds: " << nb
-                      << " t: " << diff.count() << "s" << std::endl;
-            return std::vector<char>(curr.path.begin(), curr.path.end());
+        tick();
+
+        // win ?
+        if(isWin(st, curr)) {
+            endSearch(vu.size());
+            return report("A*", solution(st, curr));
         }
 
-        std::vector<Node> next = go(curr);
-        for(auto& x : next) {
+        expand(st, curr, next);
+        ss.generated += next.size();
+        for(const auto& x : next) {
+            NodeId id = st.push(curr, x);
+
              // check deadlock dyn pour le lvl 3
-            if (test_dl(x)) {
+            if (test_dl(st, id, x.to)) {
+                st.pop();
+                ss.deadlocks++;
                 continue; // mort
             }
 
-            if(vu.find(x) == vu.end()) {
-                x.heuristic = calc_h(x);
-                vu.insert(x);
-                q.push(x);
+            // deja vu : on ne le garde que si on l'atteint par un chemin plus
+            // court, sinon la solution n'est plus optimale (comme HDA*)
+            auto it = vu.find(id);
+            if(it != vu.end()) {
+                if(st.at(*it).cost <= st.at(id).cost) {
+                    st.pop();
+                    ss.duplicates++;
+                    continue;
+                }
+                *it = id; // l'ancien reste dans la file, on le sautera
+            } else {
+                vu.add(id);
             }
+            child_h(st, id, x);
+            // plus de goal atteignable : on le garde dans vu mais on l'explore pas
+            if(st.at(id).heuristic < Heuristic::INF) q.push(id, st.at(id).f(), st.at(id).heuristic);
+        }
+        ss.openPeak = std::max<long long>(ss.openPeak, q.size());
+    }
+    endSearch(vu.size());
+    return report("A*", {});
+}
+
+std::vector<char> Solver::solveIDAStar() {
+    begin();
+    loadPatterns();
+    NodeStore st(b_init.size(), &zob, cells.data(), Heuristic::needsAssign(hType));
+    TransTable tt(ttMB);
+    if(!tt.ok()) {
+        endSearch(0);
+        return report("IDA*", {}, " (pas assez de memoire pour la table de transposition)");
+    }
+
+    NodeId s = st.root(pushMode ? normPlayer(b_init.data(), b_init.size(), p_init) : p_init, b_init);
+    st.at(s).heuristic = calc_h(st, s);
+
+    int bound = st.at(s).heuristic;
+    searching();
+    while(bound < Heuristic::INF && !cancelled()) {
+        int next = Heuristic::INF;
+        tt.seen(st.at(s).hash, 0);
+        if(ida_rec(st, s, bound, next, tt)) {
+            endSearch(0);
+            return report("IDA*", solution(st, st.size() - 1), " seuil: " + std::to_string(bound));
+        }
+        // prochain seuil = plus petit f qui a depasse celui-la
+        bound = next;
+        tt.nextIteration();
+    }
+    endSearch(0);
+    return report("IDA*", {});
+}
+
+// Cles entieres pour la BucketQueue : 10 g + (10 w) h
+std::vector<char> Solver::solveAnytime(double deadline, double w0, double step) {
+    begin();
+    loadPatterns();
+    NodeStore st(b_init.size(), &zob, cells.data(), Heuristic::needsAssign(hType));
+    VisitedSet vu(&st);
+    BucketQueue open(lifo);
+    std::vector<NodeId> incons;    // g a baisse apres developpement
+    std::vector<int> closedAt;     // tour ou le noeud a ete developpe (0 = jamais)
+    std::vector<char> inIncons;
+    auto over = [&]() {
+        return cancelled() || (deadline > 0 && since(tPhase) + ss.tInit > deadline);
+    };
+
+    NodeId s = st.root(pushMode ? normPlayer(b_init.data(), b_init.size(), p_init) : p_init, b_init);
+    st.at(s).heuristic = calc_h(st, s);
+    vu.insert(s);
+    searching();
+
+    int wt = std::max(10, (int)std::lround(w0 * 10));
+    int dw = std::max(1, (int)std::lround(step * 10));
+    auto key = [&](NodeId id) { return 10 * st.at(id).cost + wt * st.at(id).heuristic; };
+    if(st.at(s).heuristic < Heuristic::INF) open.push(s, key(s), st.at(s).heuristic);
+
+    NodeId goal = NO_NODE;
+    int gGoal = Heuristic::INF;
+    double bound = 0;
+    std::vector<char> best;
+    std::vector<Succ> next;
+    int iter = 1, rounds = 0;
+
+    while(!over()) {
+        rounds++;
+        // un tour : on developpe tant que la file a mieux que le goal
+        bool improved = false;
+        while(!open.empty() && (goal == NO_NODE || open.minKey() < 10 * gGoal) && !over()) {
+            NodeId curr = open.pop();
+            if(closedAt.size() <= curr) closedAt.resize(st.size(), 0);
+            if(closedAt[curr] == iter) continue; // doublon de la file, deja developpe ce tour-ci
+            if(refresh_h(st, curr)) {
+                if(st.at(curr).heuristic < Heuristic::INF) open.push(curr, key(curr), st.at(curr).heuristic);
+                continue;
+            }
+            closedAt[curr] = iter;
+            tick();
+
+            expand(st, curr, next);
+            ss.generated += next.size();
+            for(const auto& x : next) {
+                NodeId id = st.push(curr, x);
+                if(test_dl(st, id, x.to)) {
+                    st.pop();
+                    ss.deadlocks++;
+                    continue;
+                }
+                auto it = vu.find(id);
+                if(it == vu.end()) {
+                    vu.add(id);
+                    child_h(st, id, x);
+                } else {
+                    // deja vu : on garde le meilleur chemin en rebranchant le vieux noeud
+                    int g = st.at(id).cost;
+                    st.pop();
+                    id = *it;
+                    ss.duplicates++;
+                    Node& old = st.at(id);
+                    if(g >= old.cost) continue;
+                    old.cost = g;
+                    old.parent = curr;
+                    old.move = x.move;
+                }
+                if(isWin(st, id)) {
+                    if(st.at(id).cost < gGoal) {
+                        goal = id;
+                        gGoal = st.at(id).cost;
+                        improved = true;
+                    }
+                    continue;
+                }
+                if(st.at(id).heuristic >= Heuristic::INF) continue;
+                if(closedAt.size() > id && closedAt[id] == iter) {
+                    if(inIncons.size() <= id) inIncons.resize(st.size(), 0);
+                    if(!inIncons[id]) incons.push_back(id);
+                    inIncons[id] = 1;
+                } else {
+                    open.push(id, key(id), st.at(id).heuristic);
+                }
+            }
+            ss.openPeak = std::max<long long>(ss.openPeak, open.size());
+        }
+        if(over() && !improved) break;
+
+        // file + incons pour le tour suivant, recles avec le nouveau poids.
+        // Le plus petit g + h de ce qui reste donne la borne
+        int w = wt;
+        wt = std::max(10, wt - dw);
+        std::vector<NodeId> rest;
+        while(!open.empty()) {
+            NodeId id = open.pop();
+            if(closedAt.size() <= id || closedAt[id] != iter) rest.push_back(id);
+        }
+        std::sort(rest.begin(), rest.end());
+        rest.erase(std::unique(rest.begin(), rest.end()), rest.end()); // un noeud peut y etre 2 fois
+        rest.insert(rest.end(), incons.begin(), incons.end());
+        incons.clear();
+        std::fill(inIncons.begin(), inIncons.end(), 0);
+        iter++;
+        int fmin = Heuristic::INF;
+        for(NodeId id : rest) {
+            fmin = std::min(fmin, st.at(id).f());
+            open.push(id, key(id), st.at(id).heuristic);
+        }
+
+        if(goal == NO_NODE) {
+            if(open.empty()) break; // pas de solution
+            continue;
+        }
+        bound = fmin >= gGoal ? 1.0 : std::min(w / 10.0, (double)gGoal / std::max(1, fmin));
+        if(improved) {
+            best = solution(st, goal);
+            if(onSolution) onSolution(best, bound);
+        }
+        if(bound <= 1.0) break;
+    }
+
+    endSearch(vu.size());
+    std::ostringstream extra;
+    extra << " borne: " << bound << " tours: " << rounds;
+    return report("ARA*", best, extra.str());
+}
+
+std::vector<char> Solver::solveAStarParallel(int threads) {
+    begin();
+    loadPatterns();
+    if(threads < 1) threads = 1;
+    int n = b_init.size();
+
+    std::vector<std::unique_ptr<Worker>> ws;
+    for(int i=0; i<threads; ++i) {
+        ws.emplace_back(new Worker(n, &zob, cells.data(), Heuristic::needsAssign(hType), threads));
+    }
+    // les bits du bas du hash servent deja aux unordered_set
+    auto owner = [&](uint64_t h) { return (int)((h >> 40) % threads); };
+
+    // jetons = messages en route + threads qui ont du travail. Quand ca tombe
+    // a 0 plus personne ne peut rien produire, on a fini
+    std::atomic<long long> tokens(1);
+    std::atomic<bool> done(false);
+    std::atomic<int> best(Heuristic::INF); // cout de la meilleure solution
+    std::atomic<long long> expanded(0);    // pour la progression
+    std::mutex mx;
+    int bestW = -1;
+    NodeId bestId = NO_NODE;
+
+    Cell p0 = pushMode ? normPlayer(b_init.data(), n, p_init) : p_init;
+    int first = owner(zob.of(p0, b_init.data(), n));
+    {
+        Worker& w = *ws[first];
+        NodeId s = w.st.root(p0, b_init);
+        w.st.at(s).heuristic = calc_h(w.st, s);
+        w.vu.insert(s);
+        w.open.push(s);
+    }
+    searching();
+
+    // id vient d'etre ajoute au store de w : on le garde si c'est un nouvel
+    // etat ou si on l'atteint par un chemin plus court
+    auto accept = [&](Worker& w, NodeId id) {
+        auto it = w.vu.find(id);
+        if(it != w.vu.end()) {
+            if(w.st.at(*it).cost <= w.st.at(id).cost) {
+                w.st.pop();
+                w.dup++;
+                return false;
+            }
+            *it = id; // l'ancien reste dans la file, on le sautera
+        } else {
+            w.vu.add(id);
+        }
+        return true;
+    };
+    auto queue = [&](Worker& w, NodeId id) {
+        const Node& x = w.st.at(id);
+        if(x.heuristic >= Heuristic::INF || x.f() >= best) return false;
+        w.open.push(id);
+        return true;
+    };
+    auto flush = [&](Worker& w, int to) {
+        Batch* b = w.out[to];
+        if(!b) return;
+        tokens += b->msgs.size();
+        ws[to]->inbox.post(b);
+        w.out[to] = nullptr;
+    };
+
+    auto run = [&](int me) {
+        Worker& w = *ws[me];
+        bool active = me == first;
+        std::vector<Succ> next;
+
+        while(!done) {
+            if(cancelled()) done = true;
+            // 1. les etats que les autres nous ont envoyes
+            for(Batch* b = w.inbox.take(); b; ) {
+                bool got = false;
+                for(std::size_t i=0; i<b->msgs.size(); ++i) {
+                    const Msg& x = b->msgs[i];
+                    NodeId id = w.st.root(x.player, std::vector<Cell>(b->boxes.begin() + i * n, b->boxes.begin() + (i + 1) * n));
+                    w.st.at(id).move = x.move;
+                    w.st.at(id).cost = x.cost;
+                    if(!accept(w, id)) continue;
+                    if(w.remote.size() <= id) w.remote.resize(w.st.size(), {-1, NO_NODE});
+                    w.remote[id] = {x.fromW, x.fromId};
+                    w.st.at(id).heuristic = calc_h(w.st, id);
+                    got |= queue(w, id);
+                }
+                if(got && !active) {
+                    tokens++;
+                    active = true;
+                }
+                long long k = b->msgs.size();
+                if(tokens.fetch_sub(k) == k) done = true;
+                Batch* nx = b->next;
+                delete b;
+                b = nx;
+            }
+            if(!active) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // 2. un paquet de noeuds de notre file
+            int k = 0;
+            while(k < ROUND && !w.open.empty()) {
+                NodeId curr = w.open.top();
+                w.open.pop();
+                if(*w.vu.find(curr) != curr) continue; // remplace par un chemin plus court
+                if(w.st.at(curr).f() >= best) {
+                    w.open = decltype(w.open)(DeepNodeComparator{&w.st}); // tout le reste est au moins aussi cher
+                    break;
+                }
+                if(refresh_h(w.st, curr)) {
+                    queue(w, curr);
+                    continue;
+                }
+                k++;
+                w.nb++;
+
+                if(isWin(w.st, curr)) {
+                    std::lock_guard<std::mutex> lock(mx);
+                    if(w.st.at(curr).cost < best) {
+                        best = w.st.at(curr).cost;
+                        bestW = me;
+                        bestId = curr;
+                    }
+                    continue;
+                }
+
+                expand(w.st, curr, next);
+                w.gen += next.size();
+                for(const auto& x : next) {
+                    NodeId id = w.st.push(curr, x);
+                    if(test_dl(w.st, id, x.to)) {
+                        w.st.pop();
+                        w.dead++;
+                        continue;
+                    }
+                    int o = owner(w.st.at(id).hash);
+                    if(o == me) {
+                        if(accept(w, id)) {
+                            child_h(w.st, id, x);
+                            queue(w, id);
+                        }
+                        continue;
+                    }
+                    // pas a nous : on l'envoie
+                    if(!w.out[o]) w.out[o] = new Batch;
+                    Batch* b = w.out[o];
+                    b->msgs.push_back({w.st.at(id).playerPos, x.move, w.st.at(id).cost, me, curr});
+                    b->boxes.insert(b->boxes.end(), w.st.boxes(id), w.st.boxes(id) + n);
+                    w.st.pop();
+                    if(b->msgs.size() >= BATCH) flush(w, o);
+                }
+            }
+            for(int o=0; o<threads; ++o) flush(w, o);
+            w.peak = std::max<long long>(w.peak, w.open.size());
+
+            // progression : seul le total des noeuds developpes est tenu a
+            // jour, les autres compteurs restent chez les threads jusqu'a la fin
+            long long before = expanded.fetch_add(k);
+            if(budget.nodes && before + k >= budget.nodes) overBudget(HIT_NODES);
+            if(progress && before / progressEvery != (before + k) / progressEvery) {
+                std::lock_guard<std::mutex> lock(mx);
+                ss.expanded = before + k;
+                snapshot();
+            }
+
+            // 3. plus rien d'utile chez nous
+            if(w.open.empty()) {
+                active = false;
+                if(tokens.fetch_sub(1) == 1) done = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for(int i=0; i<threads; ++i) pool.emplace_back(run, i);
+    for(auto& t : pool) t.join();
+
+    long long closed = 0;
+    ss.expanded = 0;
+    for(auto& w : ws) {
+        ss.expanded += w->nb;
+        ss.generated += w->gen;
+        ss.duplicates += w->dup;
+        ss.deadlocks += w->dead;
+        ss.openPeak += w->peak; // chacun a son pic, pas forcement en meme temps
+        closed += w->vu.size();
+    }
+    endSearch(closed);
+    std::string extra = " threads: " + std::to_string(threads);
+    if(bestW == -1 || cancelled()) return report("A* //", {}, extra);
+
+    // on remonte les parents d'un thread a l'autre, puis on refait le
+    // chemin dans un seul store pour reutiliser solution()
+    std::vector<std::pair<int, NodeId>> chain;
+    int cw = bestW;
+    NodeId cid = bestId;
+    while(true) {
+        chain.push_back({cw, cid});
+        NodeId p = ws[cw]->st.at(cid).parent;
+        if(p != NO_NODE) {
+            cid = p;
+            continue;
+        }
+        const auto& r = ws[cw]->remote;
+        if(cid >= r.size() || r[cid].first < 0) break; // racine
+        cw = r[cid].first;
+        cid = r[cid].second;
+    }
+    std::reverse(chain.begin(), chain.end());
+
+    NodeStore st(n, &zob, cells.data());
+    NodeId cur = NO_NODE;
+    for(const auto& c : chain) {
+        const NodeStore& src = ws[c.first]->st;
+        cur = follow(st, cur, src, c.second, src.at(c.second).move);
+    }
+
+    return report("A* //", solution(st, cur), extra);
+}
+
+// Ajoute a st (apres cur) l'etat id de src, atteint par le coup move.
+// La caisse deplacee se retrouve en comparant les deux tableaux
+NodeId Solver::follow(NodeStore& st, NodeId cur, const NodeStore& src, NodeId id, char move) const {
+    int n = st.nbBoxes();
+    const Cell* b = src.boxes(id);
+    if(cur == NO_NODE) return st.root(src.at(id).playerPos, std::vector<Cell>(b, b + n));
+    const Cell* a = st.boxes(cur);
+    Cell from = NO_CELL, to = NO_CELL;
+    for(int i=0; i<n; ++i) {
+        if(!std::binary_search(b, b + n, a[i])) from = a[i];
+        if(!std::binary_search(a, a + n, b[i])) to = b[i];
+    }
+    return st.push(cur, src.at(id).playerPos, move, from, to);
+}
+
+// Tirer une caisse : le joueur est sur une case voisine p de la caisse et
+// recule d'un cran, la caisse vient en p. move = sens de la poussee qui
+// ferait le chemin inverse, comme ca on recolle direct avec la recherche avant
+void Solver::goPull(const NodeStore& st, NodeId id, std::vector<Succ>& res) const {
+    res.clear();
+    const Cell* bx = st.boxes(id);
+    int n = st.nbBoxes();
+    auto has_box = [&](Cell c) { return std::binary_search(bx, bx + n, c); };
+
+    std::vector<char> seen;
+    reach(bx, n, st.at(id).playerPos, seen);
+    std::vector<Cell> tmp;
+    for(int k=0; k<n; ++k) {
+        for(int d=0; d<4; ++d) {
+            Cell p = step(bx[k], d);
+            if(p == NO_CELL || !seen[p]) continue;
+            Cell q = step(p, d);
+            if(check_w(q) || has_box(q)) continue;
+
+            tmp.assign(bx, bx + n);
+            NodeStore::moveBox(tmp.data(), n, bx[k], p);
+            Succ sx;
+            sx.player = normPlayer(tmp.data(), n, q);
+            sx.move = d ^ 1;
+            sx.from = bx[k];
+            sx.to = p;
+            res.push_back(sx);
         }
     }
-     auto t2 = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> diff = t2 - t1;
-    std::cout << "A* rate... " << diff.count() << "s" << std::endl;
-    return {};
 }
 
-// Fonction pour voir si c mort (carre de 2x2)
-bool Solver::test_dl(const Node& n) const {
-    for (const auto& b : n.boxes) {
-        if (check_g(b)) continue; // c bon
+std::vector<char> Solver::solveBidirectional() {
+    begin();
+    if(macros) findGoalRoom(); // toujours en poussees
+    loadPatterns();
+    int n = b_init.size();
+    if((int)g.size() != n) {
+        if(verbose) std::cout << "Bidir : il faut autant de goals que de caisses" << std::endl;
+        endSearch(0);
+        return report("Bidir", {});
+    }
+
+    // un seul store et un seul vu pour les deux sens : meme codage, meme
+    // hash, donc la rencontre c'est juste un insert qui echoue
+    NodeStore st(n, &zob, cells.data());
+    VisitedSet vu(&st);
+    std::vector<char> side; // 0 = avant, 1 = arriere (par NodeId)
+
+    // chaque sens a sa file A* : en avant h = distance aux goals, en
+    // arriere h = distance en tirages jusqu'aux cases de depart des caisses
+    Heuristic back;
+    back.init(cells, nbr, b_init, w_max, true);
+    const Heuristic* hs[2] = {&heur, &back};
+    typedef std::priority_queue<NodeId, std::vector<NodeId>, DeepNodeComparator> Open;
+    Open open[2] = {Open(DeepNodeComparator{&st}), Open(DeepNodeComparator{&st})};
+    auto queue = [&](int dir, NodeId id) {
+        st.at(id).heuristic = hs[dir]->eval(hType, st.boxes(id), n);
+        if(st.at(id).heuristic < Heuristic::INF) open[dir].push(id);
+    };
+
+    NodeId s = st.root(normPlayer(b_init.data(), n, p_init), b_init);
+    side.push_back(0);
+    vu.insert(s);
+    if(isWin(st, s)) {
+        endSearch(1);
+        return report("Bidir", {});
+    }
+    queue(0, s);
+
+    // racines arriere : caisses sur les goals, joueur dans chaque zone
+    // libre de l'interieur
+    std::vector<Cell> gs = g;
+    std::sort(gs.begin(), gs.end());
+    std::vector<char> inside, zone;
+    reach(nullptr, 0, p_init, inside);
+    std::vector<char> done(h_max * w_max, 0);
+    for(int c=0; c<h_max * w_max; ++c) {
+        if(!inside[c] || done[c] || std::binary_search(gs.begin(), gs.end(), (Cell)c)) continue;
+        reach(gs.data(), n, c, zone);
+        for(int x=0; x<h_max * w_max; ++x) done[x] |= zone[x];
+        NodeId r = st.root(c, gs); // c est la plus petite case de sa zone
+        side.push_back(1);
+        if(vu.insert(r).second) {
+            queue(1, r);
+        } else {
+            st.pop();
+            side.pop_back();
+        }
+    }
+
+    searching();
+    // rencontre : meetF (avant) + la poussee bridge donne meetB (arriere)
+    NodeId meetF = NO_NODE, meetB = NO_NODE;
+    char bridge = -1;
+    std::vector<Succ> next;
+
+    // on developpe toujours le cote qui a la plus petite file
+    while(meetF == NO_NODE && !open[0].empty() && !open[1].empty() && !cancelled()) {
+        int dir = open[0].size() <= open[1].size() ? 0 : 1;
+        NodeId curr = open[dir].top();
+        open[dir].pop();
+        tick();
+        if(dir == 0) goPush(st, curr, next);
+        else goPull(st, curr, next);
+        ss.generated += next.size();
+
+        for(const auto& x : next) {
+            NodeId id = st.push(curr, x);
+            side.push_back(dir);
+            if(dir == 0 && test_dl(st, id, x.to)) {
+                st.pop();
+                side.pop_back();
+                ss.deadlocks++;
+                continue;
+            }
+            auto it = vu.find(id);
+            if(it == vu.end()) {
+                vu.add(id);
+                queue(dir, id);
+                continue;
+            }
+            NodeId other = *it;
+            st.pop();
+            side.pop_back();
+            ss.duplicates++;
+            if(side[other] != dir) {
+                meetF = dir == 0 ? curr : other;
+                meetB = dir == 0 ? other : curr;
+                bridge = x.move;
+                break;
+            }
+        }
+        ss.openPeak = std::max<long long>(ss.openPeak, open[0].size() + open[1].size());
+    }
 
-        int r = b.first;
-        int c = b.second;
+    endSearch(vu.size());
+    if(meetF == NO_NODE) return report("Bidir", {});
 
-        // check autour
-        auto chk = [&](int rr, int cc) { 
-             if (rr == r && cc == c) return true; // moi
-             if (check_w({rr, cc})) return true; // mur
-             if (n.boxes.count({rr, cc})) return true; // caisse
-             return false;
-        };
+    // depart -> meetF, la poussee du milieu, puis meetB -> goals en
+    // remontant les parents arriere (chaque move est deja une poussee)
+    std::vector<NodeId> fwd;
+    for(NodeId cur = meetF; cur != NO_NODE; cur = st.at(cur).parent) fwd.push_back(cur);
+    std::reverse(fwd.begin(), fwd.end());
 
-        // les 4 carres
-        if (chk(r-1, c-1) && chk(r-1, c) && chk(r, c-1)) return true;
-        if (chk(r-1, c) && chk(r-1, c+1) && chk(r, c+1)) return true;
-        if (chk(r, c-1) && chk(r+1, c-1) && chk(r+1, c)) return true;
-        if (chk(r, c+1) && chk(r+1, c) && chk(r+1, c+1)) return true;
+    NodeStore path(n, &zob, cells.data());
+    NodeId cur = NO_NODE;
+    for(NodeId id : fwd) cur = follow(path, cur, st, id, st.at(id).move);
+    cur = follow(path, cur, st, meetB, bridge);
+    for(NodeId b = meetB; st.at(b).parent != NO_NODE; b = st.at(b).parent) {
+        cur = follow(path, cur, st, st.at(b).parent, st.at(b).move);
+    }
+
+    return report("Bidir", pushPath(path, cur));
+}
+
+// Un tour de IDA* sous le seuil bound. Le NodeStore sert de pile (on pop en
+// remontant), si on trouve la solution c'est le dernier noeud du store
+bool Solver::ida_rec(NodeStore& st, NodeId cur, int bound, int& next, TransTable& tt) {
+    tick();
+    ss.openPeak = std::max<long long>(ss.openPeak, st.size());
+    if(isWin(st, cur)) return true;
+    if(cancelled()) return false;
+
+    std::vector<Succ> succ;
+    expand(st, cur, succ);
+    ss.generated += succ.size();
+    for(const auto& x : succ) {
+        NodeId id = st.push(cur, x);
+        if(test_dl(st, id, x.to)) {
+            st.pop();
+            ss.deadlocks++;
+            continue;
+        }
+
+        // d'abord le minorant, on ne recalcule h que si il passe sous le seuil
+        child_h(st, id, x);
+        Node& n = st.at(id);
+        if(n.f() <= bound) refresh_h(st, id);
+        if(n.heuristic >= Heuristic::INF) {
+            st.pop();
+            continue;
+        }
+        if(n.f() > bound) {
+            next = std::min(next, n.f());
+            st.pop();
+            continue;
+        }
+
+        // deja developpe avec un g plus petit (ou egal) dans ce tour
+        if(tt.seen(n.hash, n.cost)) {
+            st.pop();
+            ss.duplicates++;
+            continue;
+        }
+
+        if(ida_rec(st, id, bound, next, tt)) return true;
+        st.pop();
     }
     return false;
 }
 
-std::vector<char> Solver::solveBruteForce() {
-    auto t1 = std::chrono::high_resolution_clock::now();
-    Node s;
-    s.playerPos = p_init;
-    s.boxes = b_init;
-    std::vector<char> sol;
+// Freeze : une caisse est gelee si elle est bloquee sur les deux axes.
+// Un axe est bloque par un mur d'un cote, par des cases mortes des deux
+// cotes, ou par une caisse elle-meme gelee (les caisses deja sur le chemin
+// de la recursion comptent comme des murs, sinon on tourne en rond)
+bool Solver::frozen(const Cell* bx, int n, Cell b, std::vector<Cell>& path, bool& offGoal) const {
+    path.push_back(b);
+    auto wall = [&](Cell c) {
+        return check_w(c) || std::find(path.begin(), path.end(), c) != path.end();
+    };
+    auto box = [&](Cell c) { return std::binary_search(bx, bx + n, c); };
+
+    bool res = true;
+    for(int axis=0; axis<2 && res; ++axis) {
+        Cell a = step(b, 2 * axis), c = step(b, 2 * axis + 1);
+        if(wall(a) || wall(c)) continue;
+        if(check_dead(a) && check_dead(c)) continue;
+        if(box(a) && frozen(bx, n, a, path, offGoal)) continue;
+        if(box(c) && frozen(bx, n, c, path, offGoal)) continue;
+        res = false; // on peut bouger sur cet axe
+    }
+    path.pop_back();
+
+    if(res && !check_g(b)) offGoal = true;
+    return res;
+}
+
+// Fonction pour voir si c mort : on ne regarde que la caisse poussee,
+// mort si elle est gelee avec au moins une caisse gelee hors goal
+bool Solver::test_dl(const NodeStore& st, NodeId id, Cell moved) const {
+    return test_dl(st.boxes(id), st.nbBoxes(), moved);
+}
+
+bool Solver::test_dl(const Cell* bx, int n, Cell moved) const {
+    if (moved == NO_CELL) return false; // pas de poussee, rien n'a change
+    std::vector<Cell> path;
+    bool offGoal = false;
+    if (frozen(bx, n, moved, path, offGoal) && offGoal) return true;
+    // motif mort connu autour de la caisse
+    return patterns && ddb.dead(bx, n, moved);
+}
 
-    int max = 15;
-    std::cout << "Brute Force (max " << max << ")..." << std::endl;
+std::vector<char> Solver::solveBruteForce(int threads) {
+    begin();
+    loadPatterns();
+    ThreadPool pool(threads);
+    int T = pool.size();
+    int n = b_init.size();
+    Cell p0 = pushMode ? normPlayer(b_init.data(), n, p_init) : p_init;
 
-    if (bf_rec(s, 0, max, sol)) {
-        auto t2 = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> diff = t2 - t1;
-        std::cout << "BF trouve ! t: " << diff.count() << "s" << std::endl;
-        return sol;
+    // une seule table pour tous : un etat vu par un thread n'est pas refait
+    // par les autres
+    TransTable tt(ttMB);
+    if(!tt.ok()) {
+        endSearch(0);
+        return report("BF", {}, " (pas assez de memoire pour la table de transposition)");
     }
+    std::vector<std::unique_ptr<BfThread>> ws;
+    for(int t=0; t<T; ++t) ws.emplace_back(new BfThread(tt));
 
-    auto t2 = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> diff = t2 - t1;
-    std::cout << "BF rate... " << diff.count() << "s" << std::endl;
-    return {};
+    if(verbose) std::cout << "Brute Force (max " << bfMax << ", " << T << " threads)..." << std::endl;
+
+    std::atomic<bool> stop(false);
+    std::mutex mx;
+    std::vector<Succ> best;
+    int found = -1;
+    // compteurs des threads, remis dans ss apres chaque profondeur
+    auto collect = [&]() {
+        SearchStats sum;
+        for(auto& w : ws) {
+            sum.expanded += w->nb;
+            sum.generated += w->gen;
+            sum.duplicates += w->dup;
+            sum.deadlocks += w->dead;
+        }
+        ss.generated = sum.generated;
+        ss.duplicates = sum.duplicates;
+        ss.deadlocks = sum.deadlocks;
+        tick(sum.expanded - ss.expanded);
+    };
+    searching();
+
+    int max = 0;
+    for(; max<=bfMax && found < 0 && !cancelled(); ++max) {
+        // les premiers niveaux a la main : chaque bout de chemin est une tache
+        std::vector<std::vector<Succ>> tasks(1);
+        BfThread& w0 = *ws[0];
+        for(int d=0; d<max && tasks.size() < 8 * (std::size_t)T && tasks.size() > 0; ++d) {
+            std::vector<std::vector<Succ>> deeper;
+            for(const auto& pre : tasks) {
+                w0.s.init(p0, b_init, zob, cells.data());
+                w0.clear();
+                for(const auto& x : pre) {
+                    w0.players.push_back(w0.s.player);
+                    w0.path.push_back(x);
+                    w0.g += x.pushes;
+                    w0.s.make(x, zob, cells.data());
+                }
+                // avec les macro-coups on peut arriver au bout (ou sur la
+                // solution) en moins de max pas : on laisse bf_rec voir
+                if(w0.g >= max || w0.s.goals == n) {
+                    deeper.push_back(pre);
+                    continue;
+                }
+                std::vector<Succ> next;
+                bf_moves(w0, next);
+                for(const auto& x : next) {
+                    deeper.push_back(pre);
+                    deeper.back().push_back(x);
+                }
+            }
+            tasks.swap(deeper);
+        }
+
+        tt.nextIteration();
+        for(auto& w : ws) w->cut = false;
+        pool.forEach(tasks.size(), [&](int task, int t) {
+            if(stop) return;
+            BfThread& w = *ws[t];
+            w.s.init(p0, b_init, zob, cells.data());
+            w.clear();
+            for(const auto& x : tasks[task]) {
+                w.players.push_back(w.s.player);
+                w.path.push_back(x);
+                w.g += x.pushes;
+                w.s.make(x, zob, cells.data());
+            }
+            if(w.next.size() < (std::size_t)max) w.next.resize(max);
+            if(bf_rec(w, max, stop)) {
+                std::lock_guard<std::mutex> lock(mx);
+                if(!stop) best = w.path;
+                stop = true;
+            }
+        });
+        ss.openPeak = max; // le chemin, on ne garde rien d'autre
+        collect();
+        if(stop) found = max;
+        // rien n'a touche la profondeur max : tout est vu, pas de solution
+        bool cut = false;
+        for(auto& w : ws) cut |= w->cut;
+        if(!cut) break;
+    }
+    // on s'est arrete sur bfMax et pas parce que tout a ete vu
+    if(found < 0 && max > bfMax) overBudget(HIT_DEPTH);
+
+    endSearch(0);
+    if(found < 0) return report("BF", {}, hit == HIT_DEPTH ? " prof max: " + std::to_string(bfMax) : "");
+
+    // on remet le chemin dans un store pour avoir les coups (ou les poussees)
+    NodeStore st(n, &zob, cells.data());
+    NodeId cur = st.root(p0, b_init);
+    for(const auto& x : best) cur = st.push(cur, x);
+    return report("BF", solution(st, cur), " prof: " + std::to_string(found));
 }
 
-bool Solver::bf_rec(Node& cur, int p, int max, std::vector<char>& sol) {
-    // 1. win ?
-    bool ok = true;
-    for(const auto& b : cur.boxes) {
-        if(!check_g(b)) { ok = false; break; }
+// Successeurs de l'etat courant, sans ceux qui sont morts et sans le coup
+// qui ramene a l'etat d'avant
+void Solver::bf_moves(BfThread& w, std::vector<Succ>& res) const {
+    int n = w.s.boxes.size();
+    if(pushMode) goPush(w.s.boxes.data(), n, w.s.player, res);
+    else go(w.s.boxes.data(), n, w.s.player, res);
+    w.gen += res.size();
+
+    auto out = std::remove_if(res.begin(), res.end(), [&](const Succ& x) {
+        if(!w.path.empty()) {
+            const Succ& last = w.path.back();
+            if(x.from == last.to && x.to == last.from && x.player == w.players.back()) {
+                w.dup++;
+                return true;
+            }
+        }
+        if(x.from == NO_CELL) return false;
+        Cell prev = w.s.player;
+        w.s.make(x, zob, cells.data());
+        bool dead = test_dl(w.s.boxes.data(), n, x.to);
+        w.s.unmake(x, prev, zob, cells.data());
+        w.dead += dead;
+        return dead;
+    });
+    res.erase(out, res.end());
+}
+
+// Descente en profondeur jusqu'a un cout de max depuis l'etat de w (deja a
+// w.g du depart). Un etat deja vu dans ce tour avec un cout plus petit
+// (par n'importe quel thread) n'est pas refait (table de transposition)
+bool Solver::bf_rec(BfThread& w, int max, const std::atomic<bool>& stop) const {
+    w.nb++;
+    // 1. trop loin (un macro-coup peut sauter au-dela), sinon win ?
+    int p = w.g;
+    if (p > max) {
+        w.cut = true;
+        return false;
     }
-    if(ok) return true;
+    if (w.s.goals == (int)w.s.boxes.size()) return true;
 
     // 2. prof max
-    if (p >= max) return false;
+    if (p == max) w.cut = true;
+    if (p >= max || stop || cancelled()) return false;
+    if (w.tt.seen(w.s.hash, p)) {
+        w.dup++;
+        return false;
+    }
 
-    // 3. suite
-    std::vector<Node> next = go(cur);
+    // 3. suite (w.next a deja max cases, on ne realloue pas en descendant)
+    std::vector<Succ>& next = w.next[p];
+    bf_moves(w, next);
 
-    for (const auto& n : next) {
-        sol.push_back(n.path.back());
-        Node tmp = n; 
-        if (bf_rec(tmp, p + 1, max, sol)) {
-            return true;
-        }
+    for (const auto& x : next) {
+        Cell prev = w.s.player;
+        w.players.push_back(prev);
+        w.path.push_back(x);
+        w.g += x.pushes;
+        w.s.make(x, zob, cells.data());
+        if (bf_rec(w, max, stop)) return true;
         // backtrack
-        sol.pop_back();
+        w.s.unmake(x, prev, zob, cells.data());
+        w.g -= x.pushes;
+        w.path.pop_back();
+        w.players.pop_back();
     }
 
     return false;
 }
 
 std::vector<char> Solver::solveBestFirst() {
-    auto t1 = std::chrono::high_resolution_clock::now();
+    begin();
+    loadPatterns();
     // greedy
-    std::priority_queue<Node, std::vector<Node>, GreedyNodeComparator> q;
-    std::unordered_set<Node, NodeHash> vu;
+    NodeStore st(b_init.size(), &zob, cells.data(), Heuristic::needsAssign(hType));
+    BucketQueue q(lifo); // h seulement
+    VisitedSet vu(&st);
 
-    Node s;
-    s.playerPos = p_init;
-    s.boxes = b_init;
-    s.heuristic = calc_h(s);
+    NodeId s = st.root(pushMode ? normPlayer(b_init.data(), b_init.size(), p_init) : p_init, b_init);
+    st.at(s).heuristic = calc_h(st, s);
 
-    q.push(s);
+    q.push(s, st.at(s).heuristic);
     vu.insert(s);
+    searching();
 
-    int nb = 0;
-    while(!q.empty()) {
-        Node curr = q.top();
-        q.pop();
-        nb++;
+    std::vector<Succ> tmp;
+    while(!q.empty() && !cancelled()) {
+        NodeId curr = q.pop();
+
+        if(refresh_h(st, curr)) {
+            if(st.at(curr).heuristic < Heuristic::INF) q.push(curr, st.at(curr).heuristic);
+            continue;
+        }
+        tick();
 
         // win ?
-        bool ok = true;
-        for(const auto& b : curr.boxes) {
-            if(!check_g(b)) { ok = false; break; }
+        if(isWin(st, curr)) {
+            endSearch(vu.size());
+            return report("Greedy", solution(st, curr));
         }
-        if(ok) {
-            auto t2 = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> diff = t2 - t1;
-            std::cout << "Greedy trouve ! len: " << curr.path.size()
-                      << " noeuds: " << nb
-                      << " t: " << diff.count() << "s" << std::endl;
-            return std::vector<char>(curr.path.begin(), curr.path.end());
+
+        expand(st, curr, tmp);
+        ss.generated += tmp.size();
+        for(const auto& x : tmp) {
+            NodeId id = st.push(curr, x);
+            if(test_dl(st, id, x.to)) {
+                st.pop();
+                ss.deadlocks++;
+                continue; // gele
+            }
+            if(vu.insert(id).second) {
+                child_h(st, id, x);
+                // plus de goal atteignable : on le garde dans vu mais on l'explore pas
+                if(st.at(id).heuristic < Heuristic::INF) q.push(id, st.at(id).heuristic);
+            } else {
+                st.pop();
+                ss.duplicates++;
+            }
         }
+        ss.openPeak = std::max<long long>(ss.openPeak, q.size());
+    }
+    endSearch(vu.size());
+    return report("Greedy", {});
+}
 
-        std::vector<Node> tmp = go(curr);
-        for(auto& x : tmp) {
-            if(vu.find(x) == vu.end()) {
-                x.heuristic = calc_h(x);
-                vu.insert(x);
-                q.push(x);
+// Portfolio de base : les algos qui se completent le mieux sur les niveaux
+// du repo (A* pour les petits, Greedy / Bidir pour les gros)
+std::vector<Solver::Variant> Solver::defaultPortfolio() {
+    std::vector<Variant> vs(6);
+    vs[0].name = "A* hongroise";
+    vs[0].algo = Variant::ASTAR;
+    vs[1].name = "A* macros";
+    vs[1].algo = Variant::ASTAR;
+    vs[1].macros = true;
+    vs[2].name = "Greedy hongroise";
+    vs[2].algo = Variant::GREEDY;
+    vs[3].name = "Greedy glouton";
+    vs[3].algo = Variant::GREEDY;
+    vs[3].h = Heuristic::GREEDY_MATCH;
+    vs[4].name = "Bidir";
+    vs[4].algo = Variant::BIDIR;
+    vs[5].name = "BFS poussees";
+    vs[5].algo = Variant::BFS;
+    return vs;
+}
+
+// Une variante dans son propre Solver (ses reglages, son store, ses stats).
+// Elle ne parle pas (les lignes de toutes les variantes se melangeraient),
+// c'est le portfolio qui dit qui a gagne. Sa progression remonte a la notre,
+// marquee avec son nom, une variante a la fois
+std::vector<char> Solver::runVariant(const Variant& v, SearchStats& out, std::mutex& progressMx) {
+    Solver s(maze);
+    s.setPushMode(v.push);
+    s.setHeuristic(v.h);
+    s.setMacroMoves(v.macros);
+    s.setCorralPruning(v.corral);
+    s.setPatternDB(patterns);
+    s.setTTSize(ttMB);
+    s.setMaxDepth(bfMax);
+    s.setCancel(cancel);
+    s.setVerbose(false);
+    if(progress) {
+        s.setProgress([this, &v, &progressMx](const SearchStats& st) {
+            SearchStats tagged = st;
+            tagged.variant = v.name;
+            std::lock_guard<std::mutex> lock(progressMx);
+            progress(tagged);
+        }, progressEvery);
+    }
+    Budget b; // le temps et la memoire sont surveilles par le portfolio
+    b.nodes = budget.nodes;
+    s.setBudget(b);
+    std::vector<char> r;
+    switch(v.algo) {
+        case Variant::BFS: r = s.solveBFS(); break;
+        case Variant::DFS: r = s.solveDFS(); break;
+        case Variant::ASTAR: r = s.solveAStar(); break;
+        case Variant::GREEDY: r = s.solveBestFirst(); break;
+        case Variant::IDA: r = s.solveIDAStar(); break;
+        case Variant::BIDIR: r = s.solveBidirectional(); break;
+        case Variant::BRUTE: r = s.solveBruteForce(); break;
+    }
+    out = s.stats();
+    out.variant = v.name;
+    return r;
+}
+
+std::vector<char> Solver::solvePortfolio(const std::vector<Variant>& vs, double deadline) {
+    // le cache des motifs est fait une fois ici, sinon toutes les variantes
+    // le calculent en meme temps et ecrivent le meme fichier
+    begin();
+    loadPatterns();
+    searching();
+    auto t1 = std::chrono::high_resolution_clock::now();
+    won.clear();
+    SearchStats wst; // stats de la variante gagnante
+
+    // stop arrete toutes les variantes, il suit aussi notre propre cancel
+    std::atomic<bool> stop(false);
+    std::mutex mx, progressMx;
+    std::condition_variable cv;
+    std::vector<char> best;
+    int left = vs.size();
+
+    const std::atomic<bool>* outer = cancel;
+    cancel = &stop;
+    std::vector<std::thread> ths;
+    for(const auto& v : vs) {
+        ths.emplace_back([&, v]() {
+            SearchStats vst;
+            std::vector<char> r = runVariant(v, vst, progressMx);
+            std::lock_guard<std::mutex> lock(mx);
+            left--;
+            if(!r.empty() && !stop && (won.empty() || r.size() < best.size())) {
+                best = r;
+                won = v.name;
+                wst = vst;
+                if(deadline <= 0) stop = true; // premier arrive, on arrete les autres
             }
+            cv.notify_all();
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mx);
+        auto end = t1 + std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::duration<double>(deadline));
+        auto over = [&]() { return left == 0 || stop || hit || (outer && *outer); };
+        // on se reveille regulierement pour voir le cancel de l'appelant
+        while(!over() && (deadline <= 0 || std::chrono::high_resolution_clock::now() < end)) {
+            cv.wait_for(lock, std::chrono::milliseconds(5));
         }
+        stop = true;
     }
-    auto t2 = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> diff = t2 - t1;
-    std::cout << "Greedy rate... t: " << diff.count() << "s" << std::endl;
-    return {};
+    for(auto& t : ths) t.join();
+    cancel = outer;
+
+    // les compteurs du gagnant, les temps du portfolio
+    double tInit = ss.tInit;
+    ss = wst;
+    ss.tInit = tInit;
+    endSearch(wst.closed);
+    if(won.empty()) return report("Portfolio", {});
+    return report("Portfolio", best, " gagnant: " + won + " variantes: " + std::to_string(vs.size()));
 }
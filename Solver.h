@@ -3,6 +3,10 @@
 
 #include "Maze.h"
 #include "Node.h"
+#include "Heuristic.h"
+#include "DeadlockDB.h"
+#include "TransTable.h"
+#include "SearchStats.h"
 #include <vector>
 #include <set>
 #include <string>
@@ -11,45 +15,286 @@
 #include <iostream>
 #include <algorithm>
 #include <map>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
 
 
 class Solver {
 public:
     Solver(const Maze& m);
+    ~Solver();
+
+    Solver(const Solver&) = delete;
+    Solver& operator=(const Solver&) = delete;
 
     // algos
-    std::vector<char> solveBruteForce();
+    // Brute force en iterative deepening jusqu'a maxDepth coups (ou poussees
+    // en mode poussees, un macro-coup compte pour toutes ses poussees), les
+    // premiers niveaux de l'arbre sont repartis sur threads threads qui
+    // partagent la table de transposition. Donne toujours une solution la
+    // plus courte. Si maxDepth coupe la recherche, budgetHit() dit HIT_DEPTH
+    // (sinon il n'y a vraiment pas de solution)
+    std::vector<char> solveBruteForce(int threads = 1);
+    void setMaxDepth(int d) { bfMax = d; } // 40 par defaut
     std::vector<char> solveBFS();
+    // BFS couche par couche sur plusieurs threads, meme solution que solveBFS
+    std::vector<char> solveBFSParallel(int threads);
+    // BFS avec les couches sur disque (dans extDir, le dossier temporaire
+    // par defaut) : on garde en RAM au plus extMB Mo de fils a trier. Les
+    // doublons sont enleves apres coup en fusionnant les fichiers tries avec
+    // les couches d'avant, et le chemin est retrouve en repassant sur les
+    // couches a l'envers. Meme nombre de coups (ou de poussees) que solveBFS
+    std::vector<char> solveBFSExternal();
+    void setExtMemory(int mb) { extMB = mb; }
+    void setExtDir(const std::string& dir) { extDir = dir; }
     std::vector<char> solveDFS();
 
     std::vector<char> solveAStar();
     std::vector<char> solveBestFirst();
 
-    // check deadlock dyn
-    bool test_dl(const Node& n) const;
+    // A* reparti sur plusieurs threads (HDA*) : chaque etat appartient au
+    // thread donne par son hash, qui a sa propre file et son propre vu.
+    // Les etats generes sont envoyes a leur proprietaire par paquets.
+    // Reste optimal : on continue tant qu'un thread a un f < meilleure solution
+    std::vector<char> solveAStarParallel(int threads);
+
+    // Recherche dans les deux sens, toujours en poussees : en avant depuis le
+    // depart, en arriere (on tire les caisses) depuis toutes les caisses sur
+    // les goals, une racine par zone du joueur. Fini quand un etat est vu des
+    // deux cotes
+    std::vector<char> solveBidirectional();
+
+    // IDA* : A* en profondeur avec un seuil sur f qui monte a chaque tour.
+    // Ne garde que le chemin courant + une table de transposition de ttMB Mo,
+    // donc la memoire reste la meme quelle que soit la profondeur
+    std::vector<char> solveIDAStar();
+    void setTTSize(int mb) { ttMB = std::max(1, mb); }
+
+    // A* anytime (ARA*) : on part avec f = g + w0 * h pour avoir vite une
+    // solution, puis on baisse w de step et on repart de la meme file et du
+    // meme vu (les etats dont g a baisse apres leur developpement sont
+    // repris). Chaque meilleure solution passe par setOnSolution avec sa
+    // borne (longueur <= borne x optimum). S'arrete a la deadline (s), sur
+    // cancel, ou quand la borne arrive a 1. Rend la meilleure trouvee
+    std::vector<char> solveAnytime(double deadline = 0, double w0 = 3, double step = 0.5);
+    typedef std::function<void(const std::vector<char>&, double)> SolutionFn;
+    void setOnSolution(SolutionFn f) { onSolution = f; }
+
+    // Portfolio : plusieurs variantes (algo + reglages) en course, un thread
+    // chacune. Sans deadline (s) on garde la premiere solution et on arrete
+    // les autres, sinon la plus courte trouvee avant la deadline
+    struct Variant {
+        enum Algo { BFS, DFS, ASTAR, GREEDY, IDA, BIDIR, BRUTE };
+        std::string name;
+        Algo algo;
+        bool push = true;
+        Heuristic::Type h = Heuristic::HUNGARIAN;
+        bool macros = false;
+        bool corral = false;
+    };
+    static std::vector<Variant> defaultPortfolio();
+    std::vector<char> solvePortfolio(const std::vector<Variant>& vs = defaultPortfolio(), double deadline = 0);
+    const std::string& winner() const { return won; } // variante gagnante ("" si rien)
+
+    // compteurs de la derniere recherche
+    const SearchStats& stats() const { return ss; }
+
+    // f(stats) tous les every noeuds developpes, depuis le thread qui
+    // cherche (un des threads pour les versions //). Pour le portfolio
+    // chaque variante appelle f a son tour (jamais deux en meme temps),
+    // stats.variant dit laquelle
+    void setProgress(ProgressFn f, long long every = 100000) { progress = f; progressEvery = std::max(1LL, every); }
+
+    // ligne "trouve" / "rate" sur cout a la fin (oui par defaut)
+    void setVerbose(bool on) { verbose = on; }
+
+    // arret cooperatif : les recherches regardent *stop entre deux noeuds
+    // et rendent {} si il passe a true
+    void setCancel(const std::atomic<bool>* stop) { cancel = stop; }
+
+    // limites de chaque solve* (0 = pas de limite). Depasser c'est comme un
+    // cancel : le temps et la memoire (RSS du process) sont surveilles par
+    // un petit thread toutes les ms, les noeuds a chaque noeud developpe
+    // (a chaque profondeur pour la brute force)
+    struct Budget {
+        double seconds = 0;      // preparation comprise
+        long long nodes = 0;     // developpes
+        std::size_t memMB = 0;
+    };
+    enum BudgetHit { NO_HIT, HIT_TIME, HIT_NODES, HIT_MEMORY, HIT_DEPTH }; // HIT_DEPTH : brute force seulement
+    void setBudget(const Budget& b) { budget = b; }
+    BudgetHit budgetHit() const { return (BudgetHit)hit.load(); } // pourquoi la derniere recherche a ete coupee
+
+    // f(solver) sur un thread a part, avec une copie du niveau (on peut
+    // toucher a m pendant la recherche). stop sert de cancel
+    static std::future<std::vector<char>> solveAsync(const Maze& m, std::function<std::vector<char>(Solver&)> f,
+                                                     const std::atomic<bool>* stop = nullptr);
+
+    // mode poussees : un etat = une poussee, le joueur est normalise sur la
+    // plus petite case qu'il peut atteindre (marche pour BFS, DFS, A*, Greedy)
+    void setPushMode(bool on) { pushMode = on; }
+
+    // PI-corral en mode poussees : si une zone fermee ne peut etre ouverte
+    // que par des poussees vers l'interieur, on ne genere que celles-la.
+    // Garde une solution mais plus forcement la plus courte, donc off par defaut
+    void setCorralPruning(bool on) { corralPrune = on; }
+    long long corralPruned() const { return nbCorral; } // poussees pas generees
+
+    // macro-coups en mode poussees : une caisse qui entre dans un tunnel est
+    // poussee jusqu'au bout, et une caisse poussee sur l'entree de la salle
+    // des goals va directement a son goal de rangement
+    void setMacroMoves(bool on) { macros = on; }
+
+    // motifs morts de 2-3 caisses (calcules une fois, caches dans levels/X.txt.dl)
+    void setPatternDB(bool on) { patterns = on; }
+
+    // heuristique utilisee par A* et Greedy (Manhattan par defaut)
+    void setHeuristic(Heuristic::Type t) { hType = t; }
+
+    // A* et Greedy, a egalite (meme f et meme h pour A*, meme h pour
+    // Greedy) : le dernier noeud arrive d'abord (lifo, par defaut) ou le
+    // premier (fifo)
+    void setLifo(bool on) { lifo = on; }
+
+    // check deadlock dyn (freeze) autour de la caisse qui vient d'etre poussee en moved
+    bool test_dl(const NodeStore& st, NodeId id, Cell moved) const;
+    bool test_dl(const Cell* bx, int n, Cell moved) const;
 
 private:
-    std::vector<std::pair<int, int>> w; // murs
-    std::vector<std::pair<int, int>> g; // goals
+    const Maze& maze;
     int h_max;
     int w_max;
+    bool pushMode = false;
+    bool corralPrune = false;
+    bool patterns = true;
+    bool macros = false;
+    bool lifo = true;
+    int ttMB = 64;
+    int bfMax = 40;
+    int extMB = 256;
+    std::string extDir;
+    std::string levelPath;
+    mutable std::atomic<long long> nbCorral{0};
+    Heuristic::Type hType = Heuristic::MANHATTAN;
+    const std::atomic<bool>* cancel = nullptr;
+    std::string won;
+
+    // budget : begin() lance la surveillance si il y a du temps ou de la
+    // memoire a surveiller, endSearch() l'arrete
+    Budget budget;
+    std::atomic<int> hit{NO_HIT};
+    std::thread watch;
+    std::atomic<bool> watchStop{false};
+    void startWatch();
+    void stopWatch();
+    void overBudget(BudgetHit h) {
+        int none = NO_HIT;
+        hit.compare_exchange_strong(none, h);
+    }
+
+    // stats : begin() au debut de chaque solve*, searching() quand la
+    // preparation est finie, endSearch() quand on a trouve (ou pas),
+    // report() une fois la solution reconstruite
+    typedef std::chrono::high_resolution_clock Clock;
+    SearchStats ss;
+    ProgressFn progress;
+    SolutionFn onSolution;
+    long long progressEvery = 100000;
+    bool verbose = true;
+    Clock::time_point tPhase;
+    void begin();
+    void searching();
+    void endSearch(long long closed);
+    std::vector<char> report(const char* name, const std::vector<char>& r, const std::string& extra = "");
+    void tick(long long k = 1) {
+        long long before = ss.expanded;
+        ss.expanded += k;
+        if(budget.nodes && ss.expanded >= budget.nodes) overBudget(HIT_NODES);
+        if(progress && before / progressEvery != ss.expanded / progressEvery) snapshot();
+    }
+    void snapshot();
+    bool cancelled() const {
+        return hit.load(std::memory_order_relaxed) != NO_HIT || (cancel && cancel->load(std::memory_order_relaxed));
+    }
+    std::vector<char> runVariant(const Variant& v, SearchStats& out, std::mutex& progressMx);
 
-    std::pair<int, int> p_init;
-    std::set<std::pair<int, int>> b_init;
+    // plateau a plat, ligne par ligne : flags (C_WALL, C_GOAL...) et
+    // voisins precalcules, 4 par case dans l'ordre TOP/BOTTOM/LEFT/RIGHT
+    std::vector<uint8_t> cells;
+    std::vector<Cell> nbr;
+    std::vector<Cell> g; // goals
+    Heuristic heur;
+    DeadlockDB ddb;
+    void loadPatterns();
 
-    // helpers
-    bool check_w(const std::pair<int, int>& pos) const;
-    bool check_g(const std::pair<int, int>& pos) const;
-    
-    // pour avoir les successeurs
-    std::vector<Node> go(const Node& n) const;
+    // salle des goals : une seule entree, et l'ordre dans lequel la remplir
+    Cell roomEntrance = NO_CELL;
+    bool roomDone = false;
+    std::vector<char> inRoom;
+    std::vector<Cell> parking;
+    void findGoalRoom();
+    int macro(const Cell* bx, int n, Cell from, int dir, Cell& to, Cell& player) const;
+    int boxPath(const Cell* bx, int n, Cell box, Cell player, Cell target, std::vector<char>* dirs) const;
+
+    Cell p_init;
+    std::vector<Cell> b_init;
+
+    Cell toCell(const std::pair<int, int>& pos) const { return pos.first * w_max + pos.second; }
+
+    // helpers (NO_CELL = hors plateau, compte comme un mur)
+    Cell step(Cell c, int dir) const { return c == NO_CELL ? NO_CELL : nbr[c * 4 + dir]; }
+    bool check_w(Cell c) const { return c == NO_CELL || (cells[c] & C_WALL); }
+    bool check_g(Cell c) const { return c != NO_CELL && (cells[c] & C_GOAL); }
+    bool check_dead(Cell c) const { return c != NO_CELL && (cells[c] & C_DEAD); }
+
+    // pour avoir les successeurs (a mettre dans le store par l'appelant)
+    void go(const NodeStore& st, NodeId id, std::vector<Succ>& res) const;
+    void go(const Cell* bx, int n, Cell player, std::vector<Succ>& res) const;
+    bool isWin(const NodeStore& st, NodeId id) const;
+    void goPull(const NodeStore& st, NodeId id, std::vector<Succ>& res) const;
+    NodeId follow(NodeStore& st, NodeId cur, const NodeStore& src, NodeId id, char move) const;
+
+    // version poussees + helpers
+    void goPush(const NodeStore& st, NodeId id, std::vector<Succ>& res) const;
+    void goPush(const Cell* bx, int n, Cell player, std::vector<Succ>& res) const;
+    void expand(const NodeStore& st, NodeId id, std::vector<Succ>& res) const;
+    void reach(const Cell* bx, int n, Cell p, std::vector<char>& seen) const;
+    Cell normPlayer(const Cell* bx, int n, Cell p) const;
+    Cell normAfterPush(const Cell* bx, int n, const std::vector<char>& seen, Cell m1, Cell m2, Cell b, Cell t) const;
+    bool piCorral(const Cell* bx, int n, const std::vector<char>& seen, std::vector<char>& keep) const;
+    bool walk(const Cell* bx, int n, Cell from, Cell to, std::vector<char>& moves) const;
+    std::vector<char> pushPath(const NodeStore& st, NodeId id) const;
+    std::vector<char> solution(const NodeStore& st, NodeId id) const;
 
     // heuristique
-    int calc_h(const Node& n) const;
+    int calc_h(NodeStore& st, NodeId id) const;
+    void child_h(NodeStore& st, NodeId id, const Succ& x) const;
+    bool refresh_h(NodeStore& st, NodeId id) const;
+
+    Zobrist zob;
 
-    std::vector<std::vector<bool>> dead;
+    bool frozen(const Cell* bx, int n, Cell b, std::vector<Cell>& path, bool& offGoal) const;
 
-    bool bf_rec(Node& cur, int prof, int max_prof, std::vector<char>& sol);
+    // brute force : tout ce qu'un thread modifie pendant sa descente
+    struct BfThread {
+        State s;
+        std::vector<Succ> path;
+        std::vector<Cell> players;            // joueur avant chaque coup de path
+        std::vector<std::vector<Succ>> next;  // un buffer de successeurs par profondeur
+        int g = 0;                            // cout de path (les macro-coups comptent pour leurs poussees)
+        bool cut = false;                     // un chemin a ete coupe par la profondeur max
+        TransTable& tt;                       // partagee par tous les threads
+        long long nb = 0, gen = 0, dup = 0, dead = 0;
+        explicit BfThread(TransTable& tt) : tt(tt) {}
+        void clear() { path.clear(); players.clear(); g = 0; }
+    };
+    void bf_moves(BfThread& w, std::vector<Succ>& res) const;
+    bool bf_rec(BfThread& w, int max, const std::atomic<bool>& stop) const;
+    bool ida_rec(NodeStore& st, NodeId cur, int bound, int& next, TransTable& tt);
 };
 
 #endif // SOLVER_H
@@ -0,0 +1,84 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int threads) : nb(threads < 1 ? 1 : threads) {
+    for (int i = 1; i < nb; ++i) pool.emplace_back(&ThreadPool::loop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto& t : pool) t.join();
+}
+
+void ThreadPool::run(const std::function<void(int)>& f) {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        job = &f;
+        pending = nb - 1;
+        gen++;
+    }
+    wake.notify_all();
+    f(0);
+
+    std::unique_lock<std::mutex> lock(m);
+    finished.wait(lock, [&] { return pending == 0; });
+    job = nullptr;
+}
+
+void ThreadPool::forEach(int nbTasks, const std::function<void(int, int)>& f) {
+    struct Queue {
+        std::mutex m;
+        std::deque<int> tasks;
+    };
+    std::vector<Queue> qs(nb);
+    for (int t = 0; t < nb; ++t) {
+        for (int i = nbTasks * t / nb; i < nbTasks * (t + 1) / nb; ++i) qs[t].tasks.push_back(i);
+    }
+
+    run([&](int t) {
+        while (true) {
+            int task = -1;
+            {
+                std::lock_guard<std::mutex> lock(qs[t].m);
+                if (!qs[t].tasks.empty()) {
+                    task = qs[t].tasks.front();
+                    qs[t].tasks.pop_front();
+                }
+            }
+            // plus rien chez nous : on vole chez les autres
+            for (int k = 1; k < nb && task < 0; ++k) {
+                Queue& v = qs[(t + k) % nb];
+                std::lock_guard<std::mutex> lock(v.m);
+                if (!v.tasks.empty()) {
+                    task = v.tasks.back();
+                    v.tasks.pop_back();
+                }
+            }
+            if (task < 0) return;
+            f(task, t);
+        }
+    });
+}
+
+void ThreadPool::loop(int id) {
+    unsigned seen = 0;
+    while (true) {
+        const std::function<void(int)>* f;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            wake.wait(lock, [&] { return stop || gen != seen; });
+            if (stop) return;
+            seen = gen;
+            f = job;
+        }
+        (*f)(id);
+        {
+            std::lock_guard<std::mutex> lock(m);
+            pending--;
+        }
+        finished.notify_one();
+    }
+}
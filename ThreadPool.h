@@ -0,0 +1,44 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Groupe de threads qui restent en vie entre deux taches. run(f) lance
+// f(0) .. f(size() - 1) en meme temps (f(0) sur le thread appelant) et
+// attend qu'ils aient tous fini, comme ca on ne recree pas les threads a
+// chaque couche de BFS
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return nb; }
+    void run(const std::function<void(int)>& f);
+
+    // f(task, thread) pour task = 0 .. nbTasks - 1. Chaque thread part avec
+    // un bloc de taches contigues et quand il n'a plus rien il en vole une
+    // par la fin du bloc d'un autre
+    void forEach(int nbTasks, const std::function<void(int, int)>& f);
+
+private:
+    int nb;
+    std::vector<std::thread> pool;
+    std::mutex m;
+    std::condition_variable wake, finished;
+    const std::function<void(int)>* job = nullptr;
+    unsigned gen = 0;  // +1 a chaque run, les threads attendent que ca change
+    int pending = 0;
+    bool stop = false;
+
+    void loop(int id);
+};
+
+#endif // THREADPOOL_H
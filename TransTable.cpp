@@ -0,0 +1,48 @@
+#include "TransTable.h"
+#include <algorithm>
+#include <cstdint>
+
+TransTable::TransTable(std::size_t mb) {
+    // au moins 1 Mo, et pas plus qu'on ne peut compter en octets
+    mb = std::max<std::size_t>(1, std::min<std::size_t>(mb, SIZE_MAX >> 21));
+    // nb de paquets = plus grande puissance de 2 qui tient dans le budget
+    // (divise plutot que multiplie : nb * 4 * sizeof(Entry) deborderait)
+    std::size_t budget = mb * 1024 * 1024 / (4 * sizeof(Entry));
+    std::size_t nb = 1;
+    while (nb <= budget) nb *= 2;
+    slots = static_cast<Entry*>(std::calloc(nb * 2, sizeof(Entry)));
+    mask = slots ? nb - 1 : 0;
+}
+
+bool TransTable::seen(uint64_t key, int g) {
+    // les 32 bits du bas servent deja a placer les etats dans les VisitedSet,
+    // on prend ceux du haut pour ne pas retomber sur les memes regroupements
+    Entry* b = &slots[((key >> 32) & mask) * 2];
+    uint64_t data[2], k[2];
+    for (int i = 0; i < 2; ++i) {
+        data[i] = b[i].data.load(std::memory_order_relaxed);
+        k[i] = b[i].check.load(std::memory_order_relaxed) ^ data[i];
+    }
+    auto genOf = [](uint64_t d) { return (uint32_t)(d >> 32); };
+    auto gOf = [](uint64_t d) { return (int32_t)(uint32_t)d; };
+    auto put = [](Entry& e, uint64_t key, uint64_t d) {
+        e.data.store(d, std::memory_order_relaxed);
+        e.check.store(key ^ d, std::memory_order_relaxed);
+    };
+    uint64_t mine = ((uint64_t)gen << 32) | (uint32_t)g;
+
+    for (int i = 0; i < 2; ++i) {
+        if (genOf(data[i]) == gen && k[i] == key) {
+            if (gOf(data[i]) <= g) return true;
+            put(b[i], key, mine); // reatteint par un chemin plus court
+            return false;
+        }
+    }
+
+    // profondeur d'abord : on ne chasse l'entree 0 que si elle est perimee
+    // ou plus profonde, sinon on ecrase l'entree 1
+    bool first = genOf(data[0]) != gen || g <= gOf(data[0]);
+    if (first && genOf(data[0]) == gen) put(b[1], k[0], data[0]);
+    put(first ? b[0] : b[1], key, mine);
+    return false;
+}
@@ -0,0 +1,55 @@
+#ifndef TRANSTABLE_H
+#define TRANSTABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+
+// Table de transposition de taille fixe pour les recherches en profondeur
+// iterative (IDA*, brute force) : on retient juste le hash Zobrist d'un etat
+// et le plus petit g avec lequel on l'a deja developpe pendant l'iteration
+// en cours. La memoire ne bouge plus apres le resize,
+// quand c'est plein on ecrase (donc au pire on redeveloppe un etat).
+// Paquets de 2 entrees : la 1ere garde l'etat le moins profond (c'est lui
+// qui a le plus gros sous-arbre derriere), la 2eme est toujours remplacee.
+// Partageable entre threads sans verrou : une entree = deux mots atomiques,
+// les donnees (gen, g) et key ^ donnees. Une entree lue a moitie ecrite ne
+// redonne pas key, elle compte comme absente
+class TransTable {
+public:
+    // mb est ramene a au moins 1. Si l'allocation rate, ok() est faux et la
+    // table ne doit pas servir
+    explicit TransTable(std::size_t mb = 64);
+    ~TransTable() { std::free(slots); }
+
+    TransTable(const TransTable&) = delete;
+    TransTable& operator=(const TransTable&) = delete;
+
+    // Vrai si key a deja ete vu avec un g <= g dans cette iteration (on peut
+    // couper). Sinon l'etat est enregistre avec g. Appelable par plusieurs
+    // threads en meme temps
+    bool seen(uint64_t key, int g);
+
+    // Nouvelle iteration (seuil de IDA*, profondeur max de la brute force) :
+    // tout ce qui est dans la table devient perime. Pas pendant un seen()
+    void nextIteration() { gen++; }
+
+    bool ok() const { return slots != nullptr; }
+    std::size_t bytes() const { return slots ? (mask + 1) * 2 * sizeof(Entry) : 0; }
+
+private:
+    // data = gen << 32 | g, gen 0 = vide
+    struct Entry {
+        std::atomic<uint64_t> check; // key ^ data
+        std::atomic<uint64_t> data;
+    };
+
+    // calloc : les pages a zero ne sont vraiment allouees qu'a la premiere
+    // ecriture, donc une grosse table ne coute rien tant qu'on ne la remplit pas
+    Entry* slots;
+    std::size_t mask;
+    uint32_t gen = 1;
+};
+
+#endif // TRANSTABLE_H
@@ -0,0 +1,260 @@
+// Solveur en ligne de commande, sans Allegro (cible Batch, compile avec
+// SOKOBAN_HEADLESS). Resout une liste de niveaux (ou tous les .txt d'un
+// dossier) en parallele et ecrit une ligne par niveau, champs separes par
+// des tabulations :
+//   niveau  statut  longueur  noeuds  temps(s)  pic(Mo)  solution
+// statut = ok, rate, temps, memoire, noeuds, profondeur (brute force au bout
+// de sa profondeur max), invalide ou erreur. La solution est en LURD (udlr,
+// en majuscule quand on pousse une caisse).
+// La memoire (pic et -m) est le RSS du process : par niveau seulement avec
+// -j 1, sinon elle compte tous les niveaux en cours.
+// Les niveaux deja resolus dans la base de solutions (-d) ne sont pas
+// recherches : ok avec 0 noeud
+#include "Runner.h"
+#include "MemUsage.h"
+#include "SolutionDB.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+struct Options {
+    std::string algo = "astar";
+    int jobs = 1;             // niveaux en meme temps
+    int threads = 1;          // threads par niveau (bf, pbfs, hda)
+    double timeLimit = 0;     // s par niveau, 0 = pas de limite
+    std::size_t memLimit = 0; // Mo par niveau, 0 = pas de limite
+    long long nodeLimit = 0;  // noeuds developpes par niveau
+    bool push = true;
+    bool macros = false;
+    bool corral = false;
+    Heuristic::Type h = Heuristic::HUNGARIAN;
+    std::string out;
+    std::string db = "levels/solutions.db"; // vide = pas de base
+    std::vector<std::string> levels;
+};
+
+// Un niveau en cours, surveille par le thread de garde
+struct Slot {
+    std::atomic<bool> busy{false};
+    std::atomic<bool> stop{false};
+    std::atomic<int> why{0}; // 1 = temps, 2 = memoire
+    std::atomic<std::size_t> peak{0}; // RSS du process, tous niveaux en cours compris
+    std::atomic<double> start{0}; // en s, ecrit avant busy = true
+};
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+enum { STOP_TIME = 1, STOP_MEM = 2 };
+
+static void usage()
+{
+    std::cerr << "usage: sokoban_batch [options] niveau.txt|dossier ...\n"
+              << "  -a algo   " << Runner::ALGOS << " (astar)\n"
+              << "  -j n      niveaux resolus en parallele (1)\n"
+              << "  -n n      threads par niveau pour bf, pbfs et hda (1)\n"
+              << "  -t s      temps max par niveau en secondes\n"
+              << "  -m Mo     memoire max par niveau (RSS du process : exact avec -j 1,\n"
+              << "            sinon Mo x niveaux en cours pour tout le process)\n"
+              << "  -N n      noeuds developpes max par niveau\n"
+              << "  -H h      manhattan, glouton ou hongroise (hongroise)\n"
+              << "  -c        recherche par coups au lieu des poussees\n"
+              << "  -T        macro-coups\n"
+              << "  -K        elagage PI-corral\n"
+              << "  -o f      ecrit les resultats dans f au lieu de stdout\n"
+              << "  -d f      base de solutions (levels/solutions.db)\n"
+              << "  -D        sans base de solutions\n";
+}
+
+static bool parse(int argc, char** argv, Options& o)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool hasArg = i + 1 < argc;
+        if (a == "-a" && hasArg) o.algo = argv[++i];
+        else if (a == "-j" && hasArg) o.jobs = std::max(1, std::atoi(argv[++i]));
+        else if (a == "-n" && hasArg) o.threads = std::max(1, std::atoi(argv[++i]));
+        else if (a == "-t" && hasArg) o.timeLimit = std::atof(argv[++i]);
+        else if (a == "-m" && hasArg) o.memLimit = std::atol(argv[++i]);
+        else if (a == "-N" && hasArg) o.nodeLimit = std::atoll(argv[++i]);
+        else if (a == "-o" && hasArg) o.out = argv[++i];
+        else if (a == "-d" && hasArg) o.db = argv[++i];
+        else if (a == "-D") o.db.clear();
+        else if (a == "-H" && hasArg) {
+            std::string h = argv[++i];
+            if (h == "manhattan") o.h = Heuristic::MANHATTAN;
+            else if (h == "glouton") o.h = Heuristic::GREEDY_MATCH;
+            else if (h == "hongroise") o.h = Heuristic::HUNGARIAN;
+            else return false;
+        }
+        else if (a == "-c") o.push = false;
+        else if (a == "-T") o.macros = true;
+        else if (a == "-K") o.corral = true;
+        else if (!a.empty() && a[0] == '-') return false;
+        else Runner::addLevels(a, o.levels);
+    }
+    return !o.levels.empty();
+}
+
+static std::string solveOne(const std::string& path, const Options& o, Slot& sl, SolutionDB* db, bool& ok,
+                            bool& cached)
+{
+    ok = false;
+    cached = false;
+    std::ostringstream line;
+    line << path << '\t';
+    std::unique_ptr<Maze> m = Runner::load(path);
+    if (!m) {
+        line << "erreur\t0\t0\t0\t0\t";
+        return line.str();
+    }
+
+    uint64_t key = SolutionDB::keyOf(*m);
+    SolutionDB::Class cls = SolutionDB::classify(o.algo, o.push, o.h, o.corral, o.macros);
+    SolutionDB::Entry e;
+    std::string lurd;
+    // une entree abimee (ou une collision de hash) ne passe pas le rejeu
+    if (db && db->find(key, cls, e) && Runner::replay(path, e.moves, lurd)) {
+        ok = cached = true;
+        line << "ok\t" << e.moves.size() << "\t0\t" << now() - sl.start << '\t' << MemUsage::current() / (1024.0 * 1024.0)
+             << '\t' << lurd;
+        return line.str();
+    }
+    lurd.clear();
+
+    Solver s(*m);
+    s.setPushMode(o.push);
+    s.setHeuristic(o.h);
+    s.setMacroMoves(o.macros);
+    s.setCorralPruning(o.corral);
+    s.setCancel(&sl.stop);
+    s.setVerbose(false);
+    // ebfs : la moitie de la limite pour le tampon, le reste pour le Solver
+    if (o.memLimit) s.setExtMemory(std::max<int>(1, o.memLimit / 2));
+    // le temps et la memoire restent au thread de garde (il voit tous les
+    // niveaux en cours), le Solver ne compte que les noeuds
+    Solver::Budget b;
+    b.nodes = o.nodeLimit;
+    s.setBudget(b);
+
+    std::vector<char> sol;
+    bool known = Runner::run(s, o.algo, o.threads, sol);
+    double t = now() - sl.start;
+    sl.peak = std::max(sl.peak.load(), MemUsage::current());
+
+    std::string status;
+    if (!known) status = "erreur";
+    else if (!sol.empty()) status = Runner::replay(path, sol, lurd) ? "ok" : "invalide";
+    else if (sl.why == STOP_TIME) status = "temps";
+    else if (sl.why == STOP_MEM) status = "memoire";
+    else if (s.budgetHit() == Solver::HIT_NODES) status = "noeuds";
+    else if (s.budgetHit() == Solver::HIT_DEPTH) status = "profondeur";
+    else status = "rate";
+    ok = status == "ok";
+    if (ok && db) db->store(key, cls, sol, o.algo, s.stats());
+
+    line << status << '\t' << sol.size() << '\t' << s.stats().expanded << '\t' << t << '\t'
+         << sl.peak / (1024.0 * 1024.0) << '\t' << lurd;
+    return line.str();
+}
+
+int main(int argc, char** argv)
+{
+    Options o;
+    if (!parse(argc, argv, o)) {
+        usage();
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!o.out.empty()) {
+        file.open(o.out);
+        if (!file) {
+            std::cerr << "impossible d'ecrire " << o.out << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& res = o.out.empty() ? std::cout : file;
+
+    res << "# niveau\tstatut\tlongueur\tnoeuds\ttemps\tpic_mo\tsolution" << std::endl;
+
+    int jobs = std::min<int>(o.jobs, o.levels.size());
+    std::vector<std::unique_ptr<Slot>> slots;
+    for (int i = 0; i < jobs; ++i) slots.emplace_back(new Slot);
+
+    std::atomic<std::size_t> nextLevel(0);
+    std::atomic<bool> finished(false);
+    std::atomic<int> solved(0);
+    std::atomic<int> hits(0);
+    std::unique_ptr<SolutionDB> db;
+    if (!o.db.empty()) db.reset(new SolutionDB(o.db));
+    std::mutex mx;
+    double t1 = now();
+
+    // garde : coupe les niveaux qui depassent leur temps, et quand le process
+    // depasse memLimit x niveaux en cours on arrete celui qui tourne depuis le
+    // plus longtemps (le RSS est global, on ne sait pas qui a alloue quoi)
+    std::thread guard([&]() {
+        const std::size_t MB = 1024 * 1024;
+        while (!finished) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            std::size_t rss = MemUsage::current();
+            double t = now();
+            int running = 0;
+            Slot* oldest = nullptr;
+            for (auto& sl : slots) {
+                if (!sl->busy || sl->stop) continue;
+                running++;
+                sl->peak = std::max(sl->peak.load(), rss);
+                if (o.timeLimit > 0 && t - sl->start > o.timeLimit) {
+                    sl->why = STOP_TIME;
+                    sl->stop = true;
+                    continue;
+                }
+                if (!oldest || sl->start < oldest->start) oldest = sl.get();
+            }
+            if (o.memLimit && oldest && rss > o.memLimit * MB * running) {
+                oldest->why = STOP_MEM;
+                oldest->stop = true;
+            }
+        }
+    });
+
+    std::vector<std::thread> ws;
+    for (int k = 0; k < jobs; ++k) {
+        ws.emplace_back([&, k]() {
+            Slot& sl = *slots[k];
+            for (std::size_t i = nextLevel++; i < o.levels.size(); i = nextLevel++) {
+                sl.stop = false;
+                sl.why = 0;
+                sl.peak = MemUsage::current();
+                sl.start = now();
+                sl.busy = true;
+                bool ok, cached;
+                std::string line = solveOne(o.levels[i], o, sl, db.get(), ok, cached);
+                sl.busy = false;
+                if (ok) solved++;
+                if (cached) hits++;
+                std::lock_guard<std::mutex> lock(mx);
+                res << line << std::endl;
+            }
+        });
+    }
+    for (auto& t : ws) t.join();
+    finished = true;
+    guard.join();
+
+    double t = now() - t1;
+    std::cerr << solved << "/" << o.levels.size() << " resolus (" << hits << " en cache), " << t << "s, pic "
+              << MemUsage::peak() / (1024 * 1024) << " Mo" << std::endl;
+    return 0;
+}
@@ -0,0 +1,288 @@
+// Banc d'essai (cible Bench, sans Allegro comme le batch). Chaque algo sur
+// chaque niveau : quelques runs de chauffe puis r runs mesures, un seul a la
+// fois pour ne pas fausser les temps. Une ligne par (niveau, algo), champs
+// separes par des tabulations :
+//   niveau  algo  statut  longueur  mediane(s)  p95(s)  noeuds/s  developpes  generes  pic(Mo)
+// -o garde le tableau comme base, -b compare a une base et sort avec 1 si
+// un temps (ou un nombre de noeuds) a monte de plus du seuil, ou si un
+// niveau n'est plus resolu / a une solution plus longue
+#include "Runner.h"
+#include "MemUsage.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+struct Options {
+    std::vector<std::string> algos = {"bfs", "dfs", "astar", "greedy", "ida", "bidir", "bf", "pbfs", "ebfs", "hda", "ara"};
+    int runs = 5;
+    int warmup = 1;
+    double timeLimit = 10;    // s par run
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    bool push = true;
+    Heuristic::Type h = Heuristic::HUNGARIAN;
+    std::string save;         // -o
+    std::string base;         // -b
+    double threshold = 10;    // % au-dessus duquel c'est une regression
+    double noise = 0.005;     // s, ecart de temps en dessous duquel on ne dit rien
+    std::vector<std::string> levels;
+};
+
+// Resultat pour un (niveau, algo), c'est aussi une ligne de la base
+struct Row {
+    std::string level, algo, status;
+    std::size_t len = 0;
+    double median = 0, p95 = 0, rate = 0;
+    long long expanded = 0, generated = 0;
+    double peak = 0;
+};
+
+struct Run {
+    bool ok = false;
+    bool timeout = false;
+    std::size_t len = 0;
+    double t = 0;
+    long long expanded = 0, generated = 0;
+    std::size_t peak = 0;
+};
+
+static const char* HEADER = "# niveau\talgo\tstatut\tlongueur\tmediane\tp95\tnoeuds_s\tdeveloppes\tgeneres\tpic_mo";
+
+static void usage()
+{
+    std::cerr << "usage: sokoban_bench [options] [niveau.txt|dossier ...] (levels par defaut)\n"
+              << "  -a a,b,c  algos parmi " << Runner::ALGOS << "\n"
+              << "            (tous sauf portfolio par defaut)\n"
+              << "  -r n      runs mesures (5)\n"
+              << "  -w n      runs de chauffe (1)\n"
+              << "  -t s      temps max par run (10)\n"
+              << "  -n n      threads pour bf, pbfs et hda (tous les coeurs)\n"
+              << "  -H h      manhattan, glouton ou hongroise (hongroise)\n"
+              << "  -c        recherche par coups au lieu des poussees\n"
+              << "  -o f      garde les resultats dans f (la base)\n"
+              << "  -b f      compare a la base f\n"
+              << "  -s pct    seuil de regression en % (10)\n";
+}
+
+static bool parse(int argc, char** argv, Options& o)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool hasArg = i + 1 < argc;
+        if (a == "-a" && hasArg) {
+            o.algos.clear();
+            std::stringstream ss(argv[++i]);
+            std::string x;
+            while (std::getline(ss, x, ',')) o.algos.push_back(x);
+        }
+        else if (a == "-r" && hasArg) o.runs = std::max(1, std::atoi(argv[++i]));
+        else if (a == "-w" && hasArg) o.warmup = std::max(0, std::atoi(argv[++i]));
+        else if (a == "-t" && hasArg) o.timeLimit = std::atof(argv[++i]);
+        else if (a == "-n" && hasArg) o.threads = std::max(1, std::atoi(argv[++i]));
+        else if (a == "-o" && hasArg) o.save = argv[++i];
+        else if (a == "-b" && hasArg) o.base = argv[++i];
+        else if (a == "-s" && hasArg) o.threshold = std::atof(argv[++i]);
+        else if (a == "-H" && hasArg) {
+            std::string h = argv[++i];
+            if (h == "manhattan") o.h = Heuristic::MANHATTAN;
+            else if (h == "glouton") o.h = Heuristic::GREEDY_MATCH;
+            else if (h == "hongroise") o.h = Heuristic::HUNGARIAN;
+            else return false;
+        }
+        else if (a == "-c") o.push = false;
+        else if (!a.empty() && a[0] == '-') return false;
+        else Runner::addLevels(a, o.levels);
+    }
+    std::string known = std::string(" ") + Runner::ALGOS + " ";
+    for (const auto& a : o.algos) {
+        if (known.find(" " + a + " ") == std::string::npos) return false;
+    }
+    if (o.levels.empty()) Runner::addLevels("levels", o.levels);
+    return !o.levels.empty();
+}
+
+// Un run complet (construction du Solver comprise, c'est ce que paie un
+// appel en vrai). Un thread a cote releve le RSS et coupe au bout de timeLimit
+static Run measure(const Maze& m, const std::string& algo, const Options& o)
+{
+    Run r;
+    std::atomic<bool> stop(false), done(false);
+    std::size_t rss0 = MemUsage::current();
+    std::atomic<std::size_t> peak(rss0);
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::thread guard([&]() {
+        while (!done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            peak = std::max(peak.load(), MemUsage::current());
+            if (std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count() > o.timeLimit)
+                stop = true;
+        }
+    });
+
+    Solver s(m);
+    s.setPushMode(o.push);
+    s.setHeuristic(o.h);
+    s.setCancel(&stop);
+    s.setVerbose(false);
+    std::vector<char> sol;
+    Runner::run(s, algo, o.threads, sol);
+    r.t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+    done = true;
+    guard.join();
+
+    std::string lurd;
+    r.ok = !sol.empty() && Runner::replay(m.getPath(), sol, lurd);
+    r.timeout = stop;
+    r.len = sol.size();
+    r.expanded = s.stats().expanded;
+    r.generated = s.stats().generated;
+    r.peak = std::max(peak.load(), MemUsage::current());
+    return r;
+}
+
+static double percentile(std::vector<double> v, double p)
+{
+    std::sort(v.begin(), v.end());
+    // rang le plus proche
+    std::size_t k = (std::size_t)std::ceil(p / 100.0 * v.size());
+    return v[std::min(v.size(), std::max<std::size_t>(k, 1)) - 1];
+}
+
+static Row bench(const std::string& path, const std::string& algo, const Options& o)
+{
+    Row row;
+    row.level = path;
+    row.algo = algo;
+    std::unique_ptr<Maze> m = Runner::load(path);
+    if (!m) {
+        row.status = "erreur";
+        return row;
+    }
+
+    // la chauffe remplit aussi le cache des motifs morts. Si elle ne
+    // resout pas, les runs mesures ne feraient pas mieux
+    Run r;
+    for (int i = 0; i < o.warmup; ++i) {
+        r = measure(*m, algo, o);
+        if (!r.ok) break;
+    }
+
+    std::vector<double> times;
+    if (o.warmup == 0 || r.ok) {
+        for (int i = 0; i < o.runs; ++i) {
+            r = measure(*m, algo, o);
+            if (!r.ok) break;
+            times.push_back(r.t);
+            row.peak = std::max(row.peak, r.peak / (1024.0 * 1024.0));
+        }
+    }
+
+    row.len = r.len;
+    row.expanded = r.expanded;
+    row.generated = r.generated;
+    if (!r.ok) {
+        row.status = r.timeout ? "temps" : (r.len ? "invalide" : "rate");
+        row.peak = r.peak / (1024.0 * 1024.0);
+        row.median = row.p95 = r.t;
+        return row;
+    }
+    row.status = "ok";
+    row.median = percentile(times, 50);
+    row.p95 = percentile(times, 95);
+    row.rate = row.median > 0 ? row.expanded / row.median : 0;
+    return row;
+}
+
+static std::ostream& operator<<(std::ostream& os, const Row& r)
+{
+    return os << r.level << '\t' << r.algo << '\t' << r.status << '\t' << r.len << '\t'
+              << r.median << '\t' << r.p95 << '\t' << (long long)r.rate << '\t'
+              << r.expanded << '\t' << r.generated << '\t' << r.peak;
+}
+
+static bool load(const std::string& path, std::map<std::string, Row>& rows)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::stringstream ss(line);
+        Row r;
+        std::getline(ss, r.level, '\t');
+        std::getline(ss, r.algo, '\t');
+        std::getline(ss, r.status, '\t');
+        ss >> r.len >> r.median >> r.p95 >> r.rate >> r.expanded >> r.generated >> r.peak;
+        rows[r.level + '\t' + r.algo] = r;
+    }
+    return true;
+}
+
+// Ce qui a empire entre old et cur ("" si rien)
+static std::string regression(const Row& old, const Row& cur, const Options& o)
+{
+    double k = 1 + o.threshold / 100.0;
+    std::ostringstream why;
+    if (old.status != "ok") return "";
+    if (cur.status != "ok") return "plus resolu (" + cur.status + ")";
+    if (cur.len > old.len) why << "solution " << old.len << " -> " << cur.len << ' ';
+    if (cur.median > old.median * k && cur.median - old.median > o.noise)
+        why << "mediane +" << (int)(100 * (cur.median / old.median - 1)) << "% ";
+    if (cur.expanded > old.expanded * k)
+        why << "developpes " << old.expanded << " -> " << cur.expanded << ' ';
+    std::string s = why.str();
+    if (!s.empty()) s.pop_back();
+    return s;
+}
+
+int main(int argc, char** argv)
+{
+    Options o;
+    if (!parse(argc, argv, o)) {
+        usage();
+        return 1;
+    }
+
+    std::map<std::string, Row> base;
+    if (!o.base.empty() && !load(o.base, base)) {
+        std::cerr << "base illisible : " << o.base << std::endl;
+        return 1;
+    }
+
+    std::vector<Row> rows;
+    std::cout << HEADER << std::endl;
+    for (const auto& lv : o.levels) {
+        for (const auto& a : o.algos) {
+            rows.push_back(bench(lv, a, o));
+            std::cout << rows.back() << std::endl;
+        }
+    }
+
+    if (!o.save.empty()) {
+        std::ofstream f(o.save);
+        f << HEADER << '\n';
+        for (const auto& r : rows) f << r << '\n';
+    }
+
+    int nbReg = 0;
+    if (!o.base.empty()) {
+        std::cout << "\n# comparaison avec " << o.base << " (seuil " << o.threshold << "%)" << std::endl;
+        for (const auto& r : rows) {
+            auto it = base.find(r.level + '\t' + r.algo);
+            if (it == base.end()) continue;
+            std::string why = regression(it->second, r, o);
+            if (why.empty()) continue;
+            nbReg++;
+            std::cout << "REGRESSION\t" << r.level << '\t' << r.algo << '\t' << why << std::endl;
+        }
+        std::cout << "# " << nbReg << " regression(s)" << std::endl;
+    }
+    return nbReg ? 1 : 0;
+}
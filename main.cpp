@@ -1,8 +1,14 @@
 #include "Maze.h"
 #include "GraphicAllegro5.h"
 #include "Solver.h"
+#include "SolutionDB.h"
+#include <algorithm>
 #include <chrono>
 #include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <thread>
 
 GraphicAllegro5 graphic(1024, 768);
 
@@ -12,10 +18,47 @@ std::vector<std::string> allLevels = {
     "levels/Medium1.txt", "levels/Medium2.txt", "levels/Medium3.txt", "levels/Medium4.txt", "levels/Medium5.txt"
 };
 int currentIdx = 1; // On commence sur Easy1.txt
+bool pushMode = false; // recherche par poussees (touche M)
+Heuristic::Type heuristic = Heuristic::MANHATTAN; // pour A* et Greedy (touche H)
+bool corralMode = false; // elagage PI-corral en mode poussees (touche K)
+bool macroMode = false; // macro-coups tunnels / salle des goals (touche T)
+bool useCache = true; // solutions deja trouvees dans levels/solutions.db (touche S)
 
-void runSolver(const std::string& name, std::function<std::vector<char>()> solverFunc, Maze& m, GraphicAllegro5& g) {
+SolutionDB solutions;
+
+// Une recherche a la fois, sur un thread a part pour que la fenetre
+// reponde. Echap l'arrete (stopSearch), la boucle affiche le resultat
+std::future<std::vector<char>> search;
+std::shared_ptr<std::atomic<bool>> stopSearch; // un par recherche
+// Recherches arretees par Echap : elles sortent de leur boucle tout de
+// suite mais peuvent mettre encore un peu a rendre leur memoire, on ne les
+// attend pas pour rendre la main (on les oublie une fois finies)
+std::vector<std::future<std::vector<char>>> stopping;
+
+// algo : nom de Runner::ALGOS, pour savoir quelle solution du cache convient
+void runSolver(const std::string& name, const std::string& algo, std::function<std::vector<char>(Solver&)> solverFunc, Maze& m) {
     std::cout << "--- " << name << " ---" << std::endl;
-    std::vector<char> solution = solverFunc(); // Appel de l'algorithme (BFS, DFS, etc.)
+    uint64_t key = SolutionDB::keyOf(m);
+    SolutionDB::Class cls = SolutionDB::classify(algo, pushMode, heuristic, corralMode, macroMode);
+    SolutionDB::Entry e;
+    if (useCache && solutions.find(key, cls, e)) {
+        std::cout << "En cache : " << e.moves.size() << " coups (trouvee par " << e.algo << " en " << e.time << "s)" << std::endl;
+        m.playSolution(graphic, e.moves);
+        return;
+    }
+    std::shared_ptr<std::atomic<bool>> stop = std::make_shared<std::atomic<bool>>(false);
+    stopSearch = stop;
+    // la fonction garde stop en vie tant que la recherche tourne
+    search = Solver::solveAsync(m, [=](Solver& s) {
+        std::vector<char> sol = solverFunc(s);
+        solutions.store(key, cls, sol, algo, s.stats());
+        (void)stop;
+        return sol;
+    }, stop.get());
+}
+
+void showResult(Maze& m, GraphicAllegro5& g) {
+    std::vector<char> solution = search.get();
     if (!solution.empty()) {
         m.playSolution(g, solution);
     } else {
@@ -29,8 +72,34 @@ int main()
 
     graphic.show();
 
-    while (!graphic.keyGet(ALLEGRO_KEY_ESCAPE) && !graphic.keyGet(ALLEGRO_KEY_Q))
+    bool escHeld = false; // Echap qui vient d'arreter une recherche, pas encore relache
+    while (!graphic.keyGet(ALLEGRO_KEY_Q))
     {
+        bool esc = graphic.keyGet(ALLEGRO_KEY_ESCAPE);
+        if (!esc) escHeld = false;
+
+        stopping.erase(std::remove_if(stopping.begin(), stopping.end(), [](std::future<std::vector<char>>& f) {
+            return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }), stopping.end());
+
+        // recherche en cours : le niveau ne bouge pas, on attend la fin ou Echap
+        if (search.valid())
+        {
+            if (search.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                showResult(m, graphic);
+            } else if (esc) {
+                *stopSearch = true;
+                escHeld = true;
+                stopping.push_back(std::move(search));
+                std::cout << "Recherche arretee." << std::endl;
+            }
+            graphic.clear();
+            m.draw(graphic);
+            graphic.display();
+            continue;
+        }
+        if (esc && !escHeld) break;
+
         // Move player
         if (graphic.keyGet(ALLEGRO_KEY_UP)) m.updatePlayer(TOP);
         if (graphic.keyGet(ALLEGRO_KEY_DOWN)) m.updatePlayer(BOTTOM);
@@ -65,29 +134,104 @@ int main()
             m.playSolution(graphic, moves);
         }
 
+        if (graphic.keyGet(ALLEGRO_KEY_M))
+        {
+            pushMode = !pushMode;
+            std::cout << "Mode poussees : " << (pushMode ? "oui" : "non") << std::endl;
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_H))
+        {
+            const char* names[] = {"Manhattan", "affectation gloutonne", "hongroise"};
+            heuristic = (Heuristic::Type)((heuristic + 1) % 3);
+            std::cout << "Heuristique : " << names[heuristic] << std::endl;
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_K))
+        {
+            corralMode = !corralMode;
+            std::cout << "PI-corral : " << (corralMode ? "oui" : "non") << std::endl;
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_T))
+        {
+            macroMode = !macroMode;
+            std::cout << "Macro-coups : " << (macroMode ? "oui" : "non") << std::endl;
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_S))
+        {
+            useCache = !useCache;
+            std::cout << "Cache des solutions : " << (useCache ? "oui" : "non") << " (" << solutions.size() << " en base)" << std::endl;
+        }
+
         // Solver Triggers
         if (graphic.keyGet(ALLEGRO_KEY_F)) // BRUTE FORCE
         {
-            runSolver("Brute Force", [&](){ Solver s(m); return s.solveBruteForce(); }, m, graphic);
+            int nbThreads = std::max(1u, std::thread::hardware_concurrency());
+            runSolver("Brute Force", "bf", [=](Solver& s){ s.setPushMode(pushMode); s.setMacroMoves(macroMode); return s.solveBruteForce(nbThreads); }, m);
         }
 
         if (graphic.keyGet(ALLEGRO_KEY_B)) // BFS
         {
-            runSolver("BFS", [&](){ Solver s(m); return s.solveBFS(); }, m, graphic);
+            runSolver("BFS", "bfs", [=](Solver& s){ s.setPushMode(pushMode); s.setCorralPruning(corralMode); s.setMacroMoves(macroMode); return s.solveBFS(); }, m);
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_L)) // BFS sur tous les coeurs
+        {
+            int nbThreads = std::max(1u, std::thread::hardware_concurrency());
+            runSolver("BFS //", "pbfs", [=](Solver& s){ s.setPushMode(pushMode); s.setCorralPruning(corralMode); s.setMacroMoves(macroMode); return s.solveBFSParallel(nbThreads); }, m);
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_X)) // BFS avec les couches sur disque
+        {
+            runSolver("BFS disque", "ebfs", [=](Solver& s){ s.setPushMode(pushMode); s.setCorralPruning(corralMode); s.setMacroMoves(macroMode); return s.solveBFSExternal(); }, m);
         }
 
         if (graphic.keyGet(ALLEGRO_KEY_D)) // DFS
         {
-            runSolver("DFS", [&](){ Solver s(m); return s.solveDFS(); }, m, graphic);
+            runSolver("DFS", "dfs", [=](Solver& s){ s.setPushMode(pushMode); s.setMacroMoves(macroMode); return s.solveDFS(); }, m);
         }
         if (graphic.keyGet(ALLEGRO_KEY_A)) // A*
         {
-            runSolver("A*", [&](){ Solver s(m); return s.solveAStar(); }, m, graphic);
+            runSolver("A*", "astar", [=](Solver& s){ s.setPushMode(pushMode); s.setCorralPruning(corralMode); s.setMacroMoves(macroMode); s.setHeuristic(heuristic); return s.solveAStar(); }, m);
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_I)) // IDA*
+        {
+            runSolver("IDA*", "ida", [=](Solver& s){ s.setPushMode(pushMode); s.setCorralPruning(corralMode); s.setMacroMoves(macroMode); s.setHeuristic(heuristic); return s.solveIDAStar(); }, m);
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_W)) // A* anytime, 10 s max
+        {
+            runSolver("ARA*", "ara", [=](Solver& s){
+                s.setPushMode(pushMode); s.setCorralPruning(corralMode); s.setMacroMoves(macroMode); s.setHeuristic(heuristic);
+                s.setOnSolution([](const std::vector<char>& sol, double bound) {
+                    std::cout << "  mieux : " << sol.size() << " coups, borne " << bound << std::endl;
+                });
+                return s.solveAnytime(10);
+            }, m);
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_J)) // A* sur tous les coeurs
+        {
+            int nbThreads = std::max(1u, std::thread::hardware_concurrency());
+            runSolver("A* //", "hda", [=](Solver& s){ s.setPushMode(pushMode); s.setCorralPruning(corralMode); s.setMacroMoves(macroMode); s.setHeuristic(heuristic); return s.solveAStarParallel(nbThreads); }, m);
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_E)) // les deux sens
+        {
+            runSolver("Bidir", "bidir", [=](Solver& s){ s.setCorralPruning(corralMode); s.setMacroMoves(macroMode); s.setHeuristic(heuristic); return s.solveBidirectional(); }, m);
+        }
+
+        if (graphic.keyGet(ALLEGRO_KEY_O)) // toutes les variantes en course
+        {
+            runSolver("Portfolio", "portfolio", [](Solver& s){ return s.solvePortfolio(); }, m);
         }
 
         if (graphic.keyGet(ALLEGRO_KEY_G)) // GREEDY
 {       {
-            runSolver("Greedy", [&](){ Solver s(m); return s.solveBestFirst(); }, m, graphic);
+            runSolver("Greedy", "greedy", [=](Solver& s){ s.setPushMode(pushMode); s.setCorralPruning(corralMode); s.setMacroMoves(macroMode); s.setHeuristic(heuristic); return s.solveBestFirst(); }, m);
         }
 }
 
@@ -103,5 +247,11 @@ int main()
         graphic.display();
     }
 
+    // Q pendant une recherche : on l'arrete avant de sortir
+    if (search.valid()) {
+        *stopSearch = true;
+        search.wait();
+    }
+    stopping.clear(); // attend celles qui finissent encore
     return 0;
 }